@@ -0,0 +1,275 @@
+#ifndef __MLA_ACTOR_H__
+#define __MLA_ACTOR_H__
+
+#include "eventthread.h"
+#include "thread.h"
+
+#include "concurrentqueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace mla::thread {
+
+static constexpr std::size_t kDefaultActorQuota = 64;
+
+} // namespace mla::thread
+
+namespace detail::util
+{
+
+class ActorBase
+{
+public:
+    virtual ~ActorBase() = default;
+
+    // Process at most quota events. Returns true if the actor still has
+    // events left and must be scheduled again.
+    virtual bool run(std::size_t quota) = 0;
+};
+
+} // namespace detail::util
+
+namespace mla::thread {
+
+// Runs many actors on a fixed set of worker threads. Every worker has its
+// own run queue of actors with pending events; an actor gets at most
+// `quota` events per turn before it goes to the back of the queue, and
+// workers with nothing to do steal runnable actors from the others.
+class ActorRuntime
+{
+    using ActorBase = detail::util::ActorBase;
+
+    class Worker : public Thread
+    {
+    public:
+        Worker(ActorRuntime& runtime, std::size_t index)
+            : _runtime(runtime), _index(index)
+        {
+        }
+
+        void execute() override
+        {
+            _runtime.workerLoop(_index);
+        }
+
+        void exit() override
+        {
+            _runtime.stop();
+        }
+
+    private:
+        ActorRuntime& _runtime;
+        std::size_t _index;
+    };
+
+public:
+    explicit ActorRuntime(std::size_t workers = defaultWorkers(),
+                          std::size_t quota = kDefaultActorQuota)
+        : _quota(std::max<std::size_t>(quota, 1))
+    {
+        [[unlikely]] if(workers == 0)
+            throw std::runtime_error("Invalid number of actor workers");
+
+        _runQueues = std::vector<moodycamel::ConcurrentQueue<ActorBase*>>(
+            workers);
+        _workers.reserve(workers);
+        for(std::size_t i = 0; i < workers; ++i)
+            _workers.push_back(std::make_unique<Worker>(*this, i));
+    }
+
+    ~ActorRuntime()
+    {
+        stop();
+        join();
+    }
+
+    ActorRuntime(const ActorRuntime&) = delete;
+    ActorRuntime& operator=(const ActorRuntime&) = delete;
+
+    void start()
+    {
+        _running.store(true);
+        for(auto& worker : _workers)
+            worker->start();
+    }
+
+    // Workers finish their current turn and exit. Events still in the
+    // mailboxes are not processed.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running.store(false);
+        }
+        _cv.notify_all();
+    }
+
+    void join()
+    {
+        for(auto& worker : _workers)
+            worker->join();
+    }
+
+    [[nodiscard]] std::size_t workerCount() const
+    {
+        return _workers.size();
+    }
+
+    // Make actor runnable. Workers push to their own queue, other threads
+    // spread actors round robin.
+    void schedule(ActorBase* actor)
+    {
+        const auto& worker = currentWorker();
+        std::size_t index = worker.runtime == this
+                                ? worker.index
+                                : _next.fetch_add(1, std::memory_order_relaxed);
+        _runQueues[index % _runQueues.size()].enqueue(actor);
+
+        _queued.fetch_add(1);
+        if(_sleepers.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cv.notify_one();
+        }
+    }
+
+private:
+    static std::size_t defaultWorkers()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    struct WorkerContext
+    {
+        ActorRuntime* runtime = nullptr;
+        std::size_t index = 0;
+    };
+
+    static WorkerContext& currentWorker()
+    {
+        static thread_local WorkerContext context;
+        return context;
+    }
+
+    bool take(std::size_t index, ActorBase*& actor)
+    {
+        // Own queue first, then steal from the others
+        for(std::size_t i = 0; i < _runQueues.size(); ++i)
+        {
+            if(_runQueues[(index + i) % _runQueues.size()].try_dequeue(actor))
+            {
+                _queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(std::size_t index)
+    {
+        currentWorker() = {this, index};
+
+        ActorBase* actor = nullptr;
+        while(_running.load(std::memory_order_relaxed))
+        {
+            if(take(index, actor))
+            {
+                if(actor->run(_quota))
+                    schedule(actor);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _sleepers.fetch_add(1);
+            _cv.wait(lock,
+                     [this] { return _queued.load() > 0 || !_running.load(); });
+            _sleepers.fetch_sub(1);
+        }
+
+        currentWorker() = {};
+    }
+
+    const std::size_t _quota;
+    std::vector<moodycamel::ConcurrentQueue<ActorBase*>> _runQueues;
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    std::atomic<std::size_t> _next{0};
+    std::atomic<std::size_t> _queued{0};
+    std::atomic<int> _sleepers{0};
+    std::atomic_bool _running{false};
+    std::mutex _mutex;
+    std::condition_variable _cv;
+};
+
+// Lightweight alternative to EventThread: a mailbox that runs on the
+// workers of an ActorRuntime instead of on a thread of its own. Events are
+// dispatched to Owner::onEvent overloads exactly like in EventThread, and
+// an actor never handles two events at the same time. The run queues hold
+// plain pointers, so an actor must not be destroyed while it has pending
+// events, i.e. before the runtime has stopped or its mailbox has drained.
+template<typename Owner, typename EventType>
+class Actor : public detail::util::ActorBase
+{
+public:
+    using event_type = EventType;
+
+    explicit Actor(ActorRuntime& runtime) : _runtime(runtime) {}
+
+    Actor(const Actor&) = delete;
+    Actor& operator=(const Actor&) = delete;
+
+    void push(const EventType& event)
+    {
+        _mailbox.enqueue(event);
+        notify();
+    }
+
+    void push(EventType&& event)
+    {
+        _mailbox.enqueue(std::move(event));
+        notify();
+    }
+
+    bool run(std::size_t quota) override
+    {
+        auto* owner = static_cast<Owner*>(this);
+        const std::size_t budget =
+            std::min(quota, _pending.load(std::memory_order_acquire));
+
+        std::size_t processed = 0;
+        EventType event;
+        while(processed < budget && _mailbox.try_dequeue(event))
+        {
+            dispatchEvent(owner, event);
+            ++processed;
+        }
+
+        return _pending.fetch_sub(processed, std::memory_order_acq_rel) !=
+               processed;
+    }
+
+private:
+    // The actor is in a run queue exactly while it has pending events, so
+    // only the push that makes the mailbox non-empty schedules it
+    void notify()
+    {
+        if(_pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+            _runtime.schedule(this);
+    }
+
+    ActorRuntime& _runtime;
+    moodycamel::ConcurrentQueue<EventType> _mailbox;
+    std::atomic<std::size_t> _pending{0};
+};
+
+} // namespace mla::thread
+
+#endif // __MLA_ACTOR_H__
@@ -1,9 +1,12 @@
 #ifndef __MLA_ARRAYQUICKMAP__
 #define __MLA_ARRAYQUICKMAP__
 
+#include "detail/bitmaputil.h"
+
 #include <array>
 #include <optional>
 #include <stdexcept>
+#include <utility>
 
 namespace mla
 {
@@ -20,6 +23,8 @@ private:
         bool occupied = false;
     };
     std::array<Entry, Capacity> data;
+    // One bit per slot so iteration can skip empty slots 64 at a time
+    std::array<std::uint64_t, detail::util::bitmap_words(Capacity)> occupancy{};
     size_t _size = 0;
     float max_load_factor = 0.75f;
 
@@ -28,6 +33,28 @@ private:
         return std::hash<K>{}(key) % Capacity;
     }
 
+    // Shift the rest of the probe chain back into the slot freed by remove()
+    // so that lookups do not stop early at the hole
+    void close_gap(size_t hole)
+    {
+        size_t index = (hole + 1) % Capacity;
+        while(data[index].occupied)
+        {
+            size_t home = hash(data[index].key);
+            bool reachable = hole <= index ? (hole < home && home <= index)
+                                           : (hole < home || home <= index);
+            if(!reachable)
+            {
+                data[hole] = std::move(data[index]);
+                data[index].occupied = false;
+                detail::util::set_bit(occupancy.data(), hole);
+                detail::util::clear_bit(occupancy.data(), index);
+                hole = index;
+            }
+            index = (index + 1) % Capacity;
+        }
+    }
+
 public:
     class Iterator
     {
@@ -36,10 +63,8 @@ public:
         size_t index;
         void find_next_occupied()
         {
-            while(index < Capacity && !map->data[index].occupied)
-            {
-                ++index;
-            }
+            index = detail::util::next_set_bit(map->occupancy.data(),
+                                               Capacity, index);
         }
 
     public:
@@ -82,6 +107,7 @@ public:
         if(!data[index].occupied)
         {
             _size++;
+            detail::util::set_bit(occupancy.data(), index);
         }
         data[index] = {key, value, true};
     }
@@ -118,7 +144,9 @@ public:
             if(data[index].key == key)
             {
                 data[index].occupied = false;
+                detail::util::clear_bit(occupancy.data(), index);
                 _size--;
+                close_gap(index);
                 return;
             }
             index = (index + 1) % Capacity;
@@ -168,6 +196,26 @@ public:
     {
         return Capacity;
     }
+
+    // Call fn(key, value) for every entry, on the calling thread by
+    // default. With num_threads > 1 the table is split into ranges that are
+    // visited concurrently, so fn must then be safe to call from several
+    // threads at once. An exception from fn is rethrown here.
+    template <typename Fn>
+    void for_each(Fn&& fn, unsigned num_threads = 1)
+    {
+        detail::util::parallel_ranges(
+            Capacity, num_threads,
+            [this, &fn](size_t begin, size_t end)
+            {
+                const auto* words = occupancy.data();
+                for(size_t i = detail::util::next_set_bit(words, end, begin);
+                    i < end; i = detail::util::next_set_bit(words, end, i + 1))
+                {
+                    fn(std::as_const(data[i].key), data[i].value);
+                }
+            });
+    }
 };
 
 } // namespace mla
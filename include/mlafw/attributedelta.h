@@ -0,0 +1,239 @@
+#ifndef __MLA_ATTRIBUTEDELTA__
+#define __MLA_ATTRIBUTEDELTA__
+
+#include "attributetuple.h"
+#include "detail/tupleutil.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace mla::util
+{
+
+// Changes to an AttributeTuple<Ts...>: which attributes changed, and the
+// new values of those that are set, packed one after another in type
+// order. Unchanged attributes carry no bytes, so the values of a delta of
+// one attribute are a few bytes however wide the tuple is. They are kept
+// inline, in room for every attribute at once, so building a delta never
+// allocates; the object itself is as large as a full tuple. Deltas are
+// plain copyable values and can be pushed to an EventThread as they are.
+template <typename... Ts>
+class AttributeDelta
+{
+    static_assert((std::is_trivially_copyable_v<Ts> && ...),
+                  "Deltas hold trivially copyable attributes only");
+
+    using mask_type = detail::util::presence_mask_t<sizeof...(Ts)>;
+
+    template <typename T>
+    static constexpr std::size_t index_of =
+        detail::util::type_index_v<T, Ts...>;
+
+    template <std::size_t I>
+    static constexpr mask_type bit = mask_type{1} << I;
+
+    // Bytes of values with every attribute set
+    static constexpr std::size_t kMaxBytes = (sizeof(Ts) + ... + 0);
+
+    // Bits of the attributes after the I-th
+    template <std::size_t I>
+    static constexpr mask_type after =
+        static_cast<mask_type>(~std::uint64_t{0} << I << 1);
+
+public:
+    using tuple_type = AttributeTuple<Ts...>;
+
+    bool empty() const
+    {
+        return changedMask == 0;
+    }
+
+    // Number of changed attributes
+    std::size_t size() const
+    {
+        return std::popcount(changedMask);
+    }
+
+    // Bytes of values carried
+    std::size_t bytes() const
+    {
+        return used;
+    }
+
+    template <typename T>
+    bool changed() const
+    {
+        return changedMask & bit<index_of<T>>;
+    }
+
+    // New value of T, or nullopt if T is unchanged or was reset
+    template <typename T>
+    std::optional<T> get() const
+    {
+        static_assert(detail::util::contains_type<T, Ts...>,
+                      "Type not found in AttributeDelta");
+        std::optional<T> result;
+        forEach([&]<std::size_t I, typename U>(const std::byte* value)
+                {
+                    if constexpr(I == index_of<T>)
+                    {
+                        if(value)
+                            result.emplace(read<U>(value));
+                    }
+                });
+        return result;
+    }
+
+    void clear()
+    {
+        changedMask = setMask = 0;
+        used = 0;
+    }
+
+    // Apply to tuple, which marks the changed attributes dirty there
+    void applyTo(tuple_type& tuple) const
+    {
+        forEach(
+            [&]<std::size_t I, typename T>(const std::byte* value)
+            {
+                if(value)
+                    tuple.template set<T>(read<T>(value));
+                else
+                    tuple.template reset<T>();
+            });
+    }
+
+private:
+    template <typename T>
+    static T read(const std::byte* value)
+    {
+        T result;
+        std::memcpy(&result, value, sizeof(T));
+        return result;
+    }
+
+    // Attributes must be appended in type order
+    template <std::size_t I, typename T>
+    void append(const T* value)
+    {
+        changedMask |= bit<I>;
+        if(!value)
+            return;
+
+        setMask |= bit<I>;
+        std::memcpy(values + used, value, sizeof(T));
+        used += sizeof(T);
+    }
+
+    // Call fn.template operator()<I, T>(value) for each changed attribute,
+    // with value null for the ones that were reset
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        const std::byte* value = values;
+        [&]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            // Stops after the last changed attribute
+            auto visit = [&]<std::size_t I, typename T>()
+            {
+                if(changedMask & bit<I>)
+                {
+                    if(setMask & bit<I>)
+                    {
+                        fn.template operator()<I, T>(value);
+                        value += sizeof(T);
+                    }
+                    else
+                        fn.template operator()<I, T>(nullptr);
+                }
+                return (changedMask & after<I>) != 0;
+            };
+            (visit.template operator()<Is, Ts>() && ...);
+        }(std::index_sequence_for<Ts...>{});
+    }
+
+    template <typename... Us>
+    friend void diff(const AttributeTuple<Us...>& from,
+                     const AttributeTuple<Us...>& to,
+                     AttributeDelta<Us...>& delta);
+
+    template <typename... Us>
+    friend void takeChanges(AttributeTuple<Us...>& tuple,
+                            AttributeDelta<Us...>& delta);
+
+    mask_type changedMask = 0;
+    mask_type setMask = 0;
+    std::size_t used = 0;
+    std::byte values[std::max<std::size_t>(kMaxBytes, 1)];
+};
+
+// Fill delta with the attributes that differ between from and to
+template <typename... Ts>
+void diff(const AttributeTuple<Ts...>& from, const AttributeTuple<Ts...>& to,
+          AttributeDelta<Ts...>& delta)
+{
+    delta.clear();
+    [&]<std::size_t... Is>(std::index_sequence<Is...>)
+    {
+        auto compare = [&]<std::size_t I, typename T>()
+        {
+            auto before = from.template get<T>();
+            auto after = to.template get<T>();
+            if(before != after)
+                delta.template append<I>(after ? &*after : nullptr);
+        };
+        (compare.template operator()<Is, Ts>(), ...);
+    }(std::index_sequence_for<Ts...>{});
+}
+
+template <typename... Ts>
+AttributeDelta<Ts...> diff(const AttributeTuple<Ts...>& from,
+                           const AttributeTuple<Ts...>& to)
+{
+    AttributeDelta<Ts...> delta;
+    diff(from, to, delta);
+    return delta;
+}
+
+// Fill delta with the dirty attributes of tuple and clear them
+template <typename... Ts>
+void takeChanges(AttributeTuple<Ts...>& tuple, AttributeDelta<Ts...>& delta)
+{
+    delta.clear();
+    [&]<std::size_t... Is>(std::index_sequence<Is...>)
+    {
+        auto take = [&]<std::size_t I, typename T>()
+        {
+            if(!tuple.template dirty<T>())
+                return;
+            auto value = tuple.template get<T>();
+            delta.template append<I>(value ? &*value : nullptr);
+        };
+        (take.template operator()<Is, Ts>(), ...);
+    }(std::index_sequence_for<Ts...>{});
+    tuple.clearDirty();
+}
+
+template <typename... Ts>
+AttributeDelta<Ts...> takeChanges(AttributeTuple<Ts...>& tuple)
+{
+    AttributeDelta<Ts...> delta;
+    takeChanges(tuple, delta);
+    return delta;
+}
+
+template <typename... Ts>
+void apply(AttributeTuple<Ts...>& tuple, const AttributeDelta<Ts...>& delta)
+{
+    delta.applyTo(tuple);
+}
+
+} // namespace mla::util
+
+#endif // __MLA_ATTRIBUTEDELTA__
@@ -0,0 +1,205 @@
+#ifndef __MLA_ATTRIBUTETABLE__
+#define __MLA_ATTRIBUTETABLE__
+
+#include "attributetuple.h"
+#include "detail/bitmaputil.h"
+#include "detail/tupleutil.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mla::util
+{
+
+// Batch of AttributeTuple<Ts...> records stored column by column: each
+// attribute type has a contiguous vector of values and a presence bitmap.
+// Rows where an attribute is not set hold a value-initialized T, so a
+// column can be summed or scanned as a plain array and the bitmap only
+// needs to be consulted where that default would matter.
+template <typename... Ts>
+class AttributeTable
+{
+    // std::vector<bool> cannot be viewed as a span
+    static_assert(!(std::is_same_v<Ts, bool> || ...),
+                  "Wrap bool columns in an Attribute");
+
+    template <typename T>
+    static constexpr std::size_t index_of =
+        detail::util::type_index_v<T, Ts...>;
+
+    template <typename Table>
+    class BasicRowView
+    {
+    public:
+        BasicRowView(Table& table, std::size_t row) : table(table), row(row)
+        {
+        }
+
+        template <typename T>
+        std::optional<T> get() const
+        {
+            static_assert(detail::util::contains_type<T, Ts...>,
+                          "Type not found in AttributeTable");
+            if(!has<T>())
+                return std::nullopt;
+            return table.template column<T>()[row];
+        }
+
+        template <typename T>
+        bool has() const
+        {
+            if constexpr(detail::util::contains_type<T, Ts...>)
+                return table.template has<T>(row);
+            return false;
+        }
+
+        template <typename T>
+        static constexpr bool contains()
+        {
+            return detail::util::contains_type<T, Ts...>;
+        }
+
+        template <typename T>
+        void set(T&& value) const
+            requires(!std::is_const_v<Table>)
+        {
+            table.set(row, std::forward<T>(value));
+        }
+
+        // Copy of the row as a tuple with no attribute marked dirty
+        AttributeTuple<Ts...> tuple() const
+        {
+            AttributeTuple<Ts...> result;
+            ((has<Ts>() ? result.template set<Ts>(
+                              table.template column<Ts>()[row])
+                        : void()),
+             ...);
+            result.clearDirty();
+            return result;
+        }
+
+    private:
+        Table& table;
+        std::size_t row;
+    };
+
+public:
+    using row_type = AttributeTuple<Ts...>;
+    using row_view = BasicRowView<AttributeTable>;
+    using const_row_view = BasicRowView<const AttributeTable>;
+
+    std::size_t size() const
+    {
+        return rows;
+    }
+
+    bool empty() const
+    {
+        return rows == 0;
+    }
+
+    void reserve(std::size_t capacity)
+    {
+        (std::get<std::vector<Ts>>(columns).reserve(capacity), ...);
+        for(auto& bitmap : presence)
+            bitmap.reserve(detail::util::bitmap_words(capacity));
+    }
+
+    void clear()
+    {
+        (std::get<std::vector<Ts>>(columns).clear(), ...);
+        for(auto& bitmap : presence)
+            bitmap.clear();
+        rows = 0;
+    }
+
+    // Append a row with no attributes set
+    row_view emplace_back()
+    {
+        (std::get<std::vector<Ts>>(columns).emplace_back(), ...);
+        if(rows % detail::util::kBitsPerWord == 0)
+        {
+            for(auto& bitmap : presence)
+                bitmap.push_back(0);
+        }
+        return row_view(*this, rows++);
+    }
+
+    void push_back(const row_type& tuple)
+    {
+        auto row = emplace_back();
+        ((tuple.template has<Ts>() ? row.set(*tuple.template get<Ts>())
+                                   : void()),
+         ...);
+    }
+
+    row_view operator[](std::size_t row)
+    {
+        return row_view(*this, row);
+    }
+
+    const_row_view operator[](std::size_t row) const
+    {
+        return const_row_view(*this, row);
+    }
+
+    // Values of attribute T in row order
+    template <typename T>
+    std::span<T> column()
+    {
+        return std::get<std::vector<T>>(columns);
+    }
+
+    template <typename T>
+    std::span<const T> column() const
+    {
+        return std::get<std::vector<T>>(columns);
+    }
+
+    // Bitmap of the rows where T is set, bit row % 64 of word row / 64
+    template <typename T>
+    std::span<const std::uint64_t> present() const
+    {
+        return presence[index_of<T>];
+    }
+
+    template <typename T>
+    bool has(std::size_t row) const
+    {
+        return detail::util::test_bit(presence[index_of<T>].data(), row);
+    }
+
+    template <typename T>
+    void set(std::size_t row, T&& value)
+    {
+        using U = std::remove_cvref_t<T>;
+        static_assert(detail::util::contains_type<U, Ts...>,
+                      "Type not found in AttributeTable");
+        std::get<std::vector<U>>(columns)[row] = std::forward<T>(value);
+        detail::util::set_bit(presence[index_of<U>].data(), row);
+    }
+
+    // Unset T in row, which holds a value-initialized T again
+    template <typename T>
+    void reset(std::size_t row)
+    {
+        std::get<std::vector<T>>(columns)[row] = T{};
+        detail::util::clear_bit(presence[index_of<T>].data(), row);
+    }
+
+private:
+    std::tuple<std::vector<Ts>...> columns;
+    std::array<std::vector<std::uint64_t>, sizeof...(Ts)> presence;
+    std::size_t rows = 0;
+};
+
+} // namespace mla::util
+
+#endif // __MLA_ATTRIBUTETABLE__
@@ -3,9 +3,17 @@
 
 #include "detail/tupleutil.h"
 
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <new>
 #include <optional>
 #include <ostream>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
 namespace mla::util
@@ -15,82 +23,156 @@ namespace mla::util
 template <typename T>
 concept Primitive = std::is_arithmetic_v<T>;
 
+// Attribute tags with a name printed before the value
+template <typename Tag>
+concept NamedTag = requires {
+    { Tag::name() } -> std::convertible_to<std::string_view>;
+};
+
 template<typename T, typename Tag = void>
 class Attribute
 {
 public:
     Attribute() = default;
     Attribute(T value) requires Primitive<T> : val(value) {}
-    Attribute(const T& value) : val(value) {}
-    Attribute(T&& value) : val(std::move(value)) {}
+    Attribute(const T& value) requires(!Primitive<T>) : val(value) {}
+    Attribute(T&& value) requires(!Primitive<T>) : val(std::move(value)) {}
 
     friend std::ostream& operator<<(std::ostream& os, const Attribute& attr)
     {
-        if constexpr(requires { { Tag::name() } ->
-                std::convertible_to<std::string_view>; })
+        if constexpr(NamedTag<Tag>)
         {
             os << Tag::name() << ":";
         }
-        if(attr.val.has_value())
-            os << *attr.val;
-        return os;
+        return os << attr.val;
     }
 
+    friend bool operator==(const Attribute&, const Attribute&) = default;
+
     // For primitive types
     constexpr T get() const
         requires Primitive<T>
     {
-        return val.value_or(T{});
+        return val;
     }
 
     // For non-primitive types
     const T& get() const
         requires(!Primitive<T>)
     {
-        static const T defValue{};
-        return val.value_or(defValue);
+        return val;
     }
 
     // Non-const version for non-primitive types
     constexpr T& get()
         requires(!Primitive<T>)
     {
-        if(!val.has_value())
-            val = T{};
-        return val.value();
+        return val;
     }
 
 private:
-    std::optional<T> val;
+    // Whether it is set is up to the AttributeTuple holding it
+    T val{};
 };
 
+// Tuple of optional attributes, looked up by type. The values are packed
+// into one buffer by decreasing alignment, and a single bitmask records
+// which of them are set, instead of a flag and padding per field. A second
+// bitmask marks the attributes set or reset since clearDirty().
 template <typename... Ts>
 class AttributeTuple
 {
+    static_assert(sizeof...(Ts) <= 64,
+                  "AttributeTuple holds at most 64 attributes");
+
+    using layout = detail::util::packed_layout<Ts...>;
+    using mask_type = detail::util::presence_mask_t<sizeof...(Ts)>;
+
+    template <std::size_t I>
+    using type_at = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    template <typename T>
+    static constexpr std::size_t index_of =
+        detail::util::type_index_v<T, Ts...>;
+
+    // Tuples of these are copied and destroyed as plain bytes
+    static constexpr bool trivial =
+        (std::is_trivially_copyable_v<Ts> && ...);
+
 public:
     using tuple_type = std::tuple<std::optional<Ts>...>;
 
     // Default constructor
     AttributeTuple() = default;
 
-    // Constructor taking 1..N elements
+    // Constructor setting all elements
     template <typename... Args>
+        requires(sizeof...(Args) == sizeof...(Ts) && sizeof...(Args) > 0 &&
+                 !(std::is_same_v<std::remove_cvref_t<Args>, AttributeTuple> &&
+                   ...))
     explicit AttributeTuple(Args&&... args)
-        : data(std::make_optional<Ts>(std::forward<Args>(args))...)
     {
+        set(std::forward<Args>(args)...);
+    }
+
+    AttributeTuple(const AttributeTuple&) requires trivial = default;
+    AttributeTuple(AttributeTuple&&) requires trivial = default;
+    AttributeTuple& operator=(const AttributeTuple&) requires trivial = default;
+    AttributeTuple& operator=(AttributeTuple&&) requires trivial = default;
+    ~AttributeTuple() requires trivial = default;
+
+    AttributeTuple(const AttributeTuple& other)
+    {
+        copyFrom(other);
+    }
+
+    AttributeTuple(AttributeTuple&& other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    AttributeTuple& operator=(const AttributeTuple& other)
+    {
+        if(this != &other)
+        {
+            clear();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    AttributeTuple& operator=(AttributeTuple&& other) noexcept
+    {
+        if(this != &other)
+        {
+            clear();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    ~AttributeTuple()
+    {
+        clear();
     }
 
     // Setter for the entire tuple
     template <typename... Args>
     void set(Args&&... args)
     {
-        data = tuple_type(std::make_optional<Ts>(std::forward<Args>(args))...);
+        [&]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            (assign<Is>(std::forward<Args>(args)), ...);
+        }(std::index_sequence_for<Ts...>{});
     }
 
-    // Getter for the stored tuple
-    const auto& get() const
+    // Copy of all elements
+    tuple_type get() const
     {
-        return data;
+        return [this]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            return tuple_type(optionalAt<Is>()...);
+        }(std::index_sequence_for<Ts...>{});
     }
 
     // Getter for a specific element type
@@ -99,9 +181,17 @@ public:
     {
         static_assert(detail::util::contains_type<T, Ts...>,
                       "Type not found in AttributeTuple");
-        constexpr std::size_t index =
-            detail::util::find_type_index_v<T, tuple_type>;
-        return std::get<index>(data);
+        return optionalAt<index_of<T>>();
+    }
+
+    // Pointer to a specific element if it is set, nullptr otherwise
+    template <typename T>
+    const T* get_if() const
+    {
+        static_assert(detail::util::contains_type<T, Ts...>,
+                      "Type not found in AttributeTuple");
+        constexpr std::size_t index = index_of<T>;
+        return test<index>() ? &at<index>() : nullptr;
     }
 
     // Setter for a specific element type
@@ -110,9 +200,7 @@ public:
     {
         static_assert(detail::util::contains_type<T, Ts...>,
                       "Type not found in AttributeTuple");
-        constexpr std::size_t index =
-            detail::util::find_type_index_v<T, tuple_type>;
-        std::get<index>(data) = std::make_optional(value);
+        assign<index_of<T>>(value);
     }
 
     // Setter for a specific element type (move version)
@@ -121,9 +209,22 @@ public:
     {
         static_assert(detail::util::contains_type<T, Ts...>,
                       "Type not found in AttributeTuple");
-        constexpr std::size_t index =
-            detail::util::find_type_index_v<T, tuple_type>;
-        std::get<index>(data) = std::make_optional(std::forward<T>(value));
+        assign<index_of<T>>(std::forward<T>(value));
+    }
+
+    // Unset a specific element type
+    template <typename T>
+    void reset()
+    {
+        static_assert(detail::util::contains_type<T, Ts...>,
+                      "Type not found in AttributeTuple");
+        constexpr std::size_t index = index_of<T>;
+        if(test<index>())
+        {
+            std::destroy_at(&at<index>());
+            present &= ~bit<index>;
+        }
+        dirtyMask |= bit<index>;
     }
 
     // Check if a specific type exists in the tuple
@@ -138,23 +239,186 @@ public:
     bool has() const
     {
         if constexpr(detail::util::contains_type<T, Ts...>)
-        {
-            constexpr std::size_t index =
-                detail::util::find_type_index_v<T, tuple_type>;
-            return std::get<index>(data).has_value();
-        }
+            return test<index_of<T>>();
+        return false;
+    }
+
+    // Check if a specific type was set or reset since clearDirty()
+    template <typename T>
+    bool dirty() const
+    {
+        if constexpr(detail::util::contains_type<T, Ts...>)
+            return dirtyMask & bit<index_of<T>>;
         return false;
     }
 
+    bool dirty() const
+    {
+        return dirtyMask != 0;
+    }
+
+    void clearDirty()
+    {
+        dirtyMask = 0;
+    }
+
     // Printer for AttributeTuple
     friend std::ostream& operator<<(std::ostream& os, const AttributeTuple& tuple)
     {
-        return os << detail::util::print_tuple(tuple.data);
+        return os << detail::util::print_tuple(tuple.get());
     }
+
 private:
-    tuple_type data;
+    template <std::size_t I>
+    static constexpr mask_type bit = mask_type{1} << I;
+
+    template <std::size_t I>
+    bool test() const
+    {
+        return present & bit<I>;
+    }
+
+    template <std::size_t I>
+    void* raw()
+    {
+        return storage + layout::offsets[I];
+    }
+
+    template <std::size_t I>
+    type_at<I>& at()
+    {
+        return *std::launder(static_cast<type_at<I>*>(raw<I>()));
+    }
+
+    template <std::size_t I>
+    const type_at<I>& at() const
+    {
+        return const_cast<AttributeTuple*>(this)->template at<I>();
+    }
+
+    template <std::size_t I>
+    std::optional<type_at<I>> optionalAt() const
+    {
+        if(!test<I>())
+            return std::nullopt;
+        return at<I>();
+    }
+
+    template <std::size_t I, typename U>
+    void assign(U&& value)
+    {
+        using T = type_at<I>;
+        if(!test<I>())
+        {
+            ::new(raw<I>()) T(std::forward<U>(value));
+            present |= bit<I>;
+        }
+        else if constexpr(std::is_assignable_v<T&, U&&>)
+            at<I>() = std::forward<U>(value);
+        else
+            at<I>() = T(std::forward<U>(value));
+        dirtyMask |= bit<I>;
+    }
+
+    void clear()
+    {
+        [this]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            ((test<Is>() ? std::destroy_at(&at<Is>()) : void()), ...);
+        }(std::index_sequence_for<Ts...>{});
+        present = 0;
+    }
+
+    void copyFrom(const AttributeTuple& other)
+    {
+        [&]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            ((other.template test<Is>() ? assign<Is>(other.template at<Is>())
+                                        : void()),
+             ...);
+        }(std::index_sequence_for<Ts...>{});
+        dirtyMask = other.dirtyMask;
+    }
+
+    void moveFrom(AttributeTuple& other)
+    {
+        [&]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            ((other.template test<Is>()
+                  ? assign<Is>(std::move(other.template at<Is>()))
+                  : void()),
+             ...);
+        }(std::index_sequence_for<Ts...>{});
+        dirtyMask = other.dirtyMask;
+        other.clear();
+    }
+
+    alignas(layout::alignment) std::byte storage[std::max<std::size_t>(
+        layout::size, 1)];
+    mask_type present = 0;
+    mask_type dirtyMask = 0;
 };
 
 } // namespace mla::util
 
+// std::format support, writing straight to the output iterator. Values
+// follow std::format rather than operator<<: floating point prints in the
+// shortest form that reads back exactly (0.3333333333333333, not 0.333333),
+// bool as true/false and signed or unsigned char as a number.
+template <typename T, typename Tag>
+struct std::formatter<mla::util::Attribute<T, Tag>, char>
+{
+    constexpr auto parse(std::format_parse_context& ctx)
+    {
+        return ctx.begin();
+    }
+
+    template <typename FormatContext>
+    auto format(const mla::util::Attribute<T, Tag>& attr,
+                FormatContext& ctx) const
+    {
+        auto out = ctx.out();
+        if constexpr(mla::util::NamedTag<Tag>)
+        {
+            const std::string_view name = Tag::name();
+            out = std::copy(name.begin(), name.end(), out);
+            *out++ = ':';
+        }
+        return std::format_to(out, "{}", attr.get());
+    }
+};
+
+// Unset elements are left empty: "(1, , three)"
+template <typename... Ts>
+struct std::formatter<mla::util::AttributeTuple<Ts...>, char>
+{
+    constexpr auto parse(std::format_parse_context& ctx)
+    {
+        return ctx.begin();
+    }
+
+    template <typename FormatContext>
+    auto format(const mla::util::AttributeTuple<Ts...>& tuple,
+                FormatContext& ctx) const
+    {
+        auto out = ctx.out();
+        *out++ = '(';
+        bool first = true;
+        auto write = [&]<typename T>()
+        {
+            if(!first)
+            {
+                *out++ = ',';
+                *out++ = ' ';
+            }
+            first = false;
+            if(const T* value = tuple.template get_if<T>())
+                out = std::format_to(out, "{}", *value);
+        };
+        (write.template operator()<Ts>(), ...);
+        *out++ = ')';
+        return out;
+    }
+};
+
 #endif // __MLA_ATTRIBUTETUPLE__
@@ -0,0 +1,154 @@
+#ifndef __MLA_ATTRIBUTEWIRE__
+#define __MLA_ATTRIBUTEWIRE__
+
+#include "attributetuple.h"
+#include "detail/tupleutil.h"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+namespace mla::util
+{
+
+// Binary layout of AttributeTuple<Ts...>: the presence bitmask, bit i for
+// the i-th type, followed by every field in declaration order. Unset
+// fields are zero. Offsets are fixed, so a received buffer can be read in
+// place. Values are raw bytes in host order, for peers on the same
+// architecture.
+template <typename... Ts>
+struct wire_format
+{
+    static_assert((std::is_trivially_copyable_v<Ts> && ...),
+                  "Only trivially copyable attributes have a wire format");
+
+    using mask_type = detail::util::presence_mask_t<sizeof...(Ts)>;
+
+    static constexpr std::array<std::size_t, sizeof...(Ts)> offsets = []
+    {
+        constexpr std::array<std::size_t, sizeof...(Ts)> sizes{sizeof(Ts)...};
+        std::array<std::size_t, sizeof...(Ts)> result{};
+        std::size_t offset = sizeof(mask_type);
+        for(std::size_t i = 0; i < sizes.size(); ++i)
+        {
+            result[i] = offset;
+            offset += sizes[i];
+        }
+        return result;
+    }();
+
+    static constexpr std::size_t size = (sizeof(mask_type) + ... + sizeof(Ts));
+};
+
+template <typename Tuple>
+inline constexpr std::size_t wire_size_v = 0;
+
+template <typename... Ts>
+inline constexpr std::size_t wire_size_v<AttributeTuple<Ts...>> =
+    wire_format<Ts...>::size;
+
+// Write tuple to out, which needs wire_size_v bytes. Returns the number of
+// bytes written.
+template <typename... Ts>
+std::size_t encode(const AttributeTuple<Ts...>& tuple,
+                   std::span<std::byte> out)
+{
+    using format = wire_format<Ts...>;
+    [[unlikely]] if(out.size() < format::size)
+        throw std::runtime_error("Buffer too small for AttributeTuple");
+
+    typename format::mask_type mask = 0;
+    [&]<std::size_t... Is>(std::index_sequence<Is...>)
+    {
+        auto write = [&]<std::size_t I, typename T>()
+        {
+            std::byte* field = out.data() + format::offsets[I];
+            if(const T* value = tuple.template get_if<T>())
+            {
+                std::memcpy(field, value, sizeof(T));
+                mask |= typename format::mask_type{1} << I;
+            }
+            else
+                std::memset(field, 0, sizeof(T));
+        };
+        (write.template operator()<Is, Ts>(), ...);
+    }(std::index_sequence_for<Ts...>{});
+
+    std::memcpy(out.data(), &mask, sizeof(mask));
+    return format::size;
+}
+
+// Read-only AttributeTuple over an encoded buffer. Nothing is copied until
+// a field is read; the buffer must outlive the view.
+template <typename... Ts>
+class AttributeTupleView
+{
+    using format = wire_format<Ts...>;
+
+    template <typename T>
+    static constexpr std::size_t index_of =
+        detail::util::type_index_v<T, Ts...>;
+
+public:
+    explicit AttributeTupleView(std::span<const std::byte> bytes)
+        : bytes(bytes.data())
+    {
+        [[unlikely]] if(bytes.size() < format::size)
+            throw std::runtime_error("Buffer too small for AttributeTuple");
+        std::memcpy(&mask, this->bytes, sizeof(mask));
+    }
+
+    template <typename T>
+    std::optional<T> get() const
+    {
+        static_assert(detail::util::contains_type<T, Ts...>,
+                      "Type not found in AttributeTupleView");
+        if(!has<T>())
+            return std::nullopt;
+
+        // The buffer has no alignment, so fields are copied out
+        T value;
+        std::memcpy(&value, bytes + format::offsets[index_of<T>], sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    bool has() const
+    {
+        if constexpr(detail::util::contains_type<T, Ts...>)
+            return (mask >> index_of<T>) & 1;
+        return false;
+    }
+
+    template <typename T>
+    static constexpr bool contains()
+    {
+        return detail::util::contains_type<T, Ts...>;
+    }
+
+    // Decode into an AttributeTuple, with no attribute marked dirty
+    AttributeTuple<Ts...> tuple() const
+    {
+        AttributeTuple<Ts...> result;
+        ((has<Ts>() ? result.template set<Ts>(*get<Ts>()) : void()), ...);
+        result.clearDirty();
+        return result;
+    }
+
+    std::span<const std::byte> data() const
+    {
+        return {bytes, format::size};
+    }
+
+private:
+    const std::byte* bytes;
+    typename format::mask_type mask = 0;
+};
+
+} // namespace mla::util
+
+#endif // __MLA_ATTRIBUTEWIRE__
@@ -0,0 +1,289 @@
+#ifndef __MLA_CLOCK_H__
+#define __MLA_CLOCK_H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#if defined(__x86_64__) && !defined(MLA_NO_TSC)
+#define MLA_HAS_TSC
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace mla::clock {
+
+// steady_clock read from the CPU's time stamp counter. The counter is
+// calibrated against steady_clock once, spinning kCalibrationTime on first
+// use, and corrected every kRecalibrationInterval: the rate is measured
+// over the whole run and the clock is slewed towards steady_clock, running
+// at the measured rate when not read for longer. It never steps back: when
+// ahead it runs slower, at no less than half the measured rate, until
+// steady_clock catches up. Time points are steady_clock ones and can be
+// mixed freely. Falls back to steady_clock, i.e. clock_gettime
+// (CLOCK_MONOTONIC), when the CPU has no invariant TSC, when the TSC drifts
+// more than kMaxDrift, on other architectures, or when built with
+// MLA_NO_TSC. After such a switch, now() holds at the last TSC time until
+// steady_clock passes it.
+class FastClock
+{
+public:
+    using duration = std::chrono::steady_clock::duration;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::steady_clock::time_point;
+    static constexpr bool is_steady = true;
+
+    static constexpr std::chrono::milliseconds kCalibrationTime{1};
+    static constexpr std::chrono::milliseconds kRecalibrationInterval{100};
+    static constexpr std::chrono::milliseconds kMaxDrift{1};
+
+    static time_point now() noexcept
+    {
+#ifdef MLA_HAS_TSC
+        auto& self = instance();
+        if(self._reliable.load(std::memory_order_relaxed)) [[likely]]
+        {
+            return time_point(std::chrono::duration_cast<duration>(
+                std::chrono::nanoseconds(self.read())));
+        }
+        return time_point(std::chrono::duration_cast<duration>(
+            std::chrono::nanoseconds(self.fallbackNs())));
+#endif
+        return std::chrono::steady_clock::now();
+    }
+
+    // system_clock time of a time point, following adjustments of the
+    // system clock within kRecalibrationInterval
+    static std::chrono::system_clock::time_point toWall(time_point time)
+    {
+        std::chrono::nanoseconds offset;
+        if(usingTsc())
+            offset = std::chrono::nanoseconds(
+                instance()._wallOffset.load(std::memory_order_relaxed));
+        else
+            offset = std::chrono::nanoseconds(systemNs() - steadyNs());
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                time.time_since_epoch() + offset));
+    }
+
+    static std::chrono::system_clock::time_point wallNow()
+    {
+        if(!usingTsc())
+            return std::chrono::system_clock::now();
+        return toWall(now());
+    }
+
+    static bool usingTsc() noexcept
+    {
+#ifdef MLA_HAS_TSC
+        return instance()._reliable.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    }
+
+private:
+    FastClock()
+    {
+#ifdef MLA_HAS_TSC
+        if(!invariantTsc())
+            return;
+
+        auto [startTsc, startNs] = sample();
+        const auto calibrationNs =
+            std::chrono::nanoseconds(kCalibrationTime).count();
+        while(steadyNs() - startNs < calibrationNs)
+            ;
+        auto [counter, ns] = sample();
+        if(counter <= startTsc)
+            return;
+
+        _startTsc = startTsc;
+        _startNs = startNs;
+        calibrate(counter, ns, ns, systemNs());
+        _reliable.store(true, std::memory_order_relaxed);
+#endif
+    }
+
+    FastClock(const FastClock&) = delete;
+    FastClock& operator=(const FastClock&) = delete;
+
+    static FastClock& instance()
+    {
+        static FastClock clock;
+        return clock;
+    }
+
+    static std::int64_t steadyNs() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // steady_clock, but not behind the last time read from the TSC
+    std::int64_t fallbackNs() const noexcept
+    {
+        return std::max(steadyNs(), _floor.load(std::memory_order_relaxed));
+    }
+
+    static std::int64_t systemNs() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+#ifdef MLA_HAS_TSC
+    static bool invariantTsc()
+    {
+        unsigned eax, ebx, ecx, edx;
+        if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+            return false;
+        return edx & (1u << 8);
+    }
+
+    // Counter value taken halfway through reading steady_clock
+    static std::pair<std::uint64_t, std::int64_t> sample() noexcept
+    {
+        auto before = __rdtsc();
+        auto ns = steadyNs();
+        auto after = __rdtsc();
+        return {before + (after - before) / 2, ns};
+    }
+
+    // ticks * mult with mult in nanoseconds per tick, fixed point << 32
+    static std::int64_t scale(std::uint64_t ticks, std::uint64_t mult) noexcept
+    {
+        return static_cast<std::int64_t>(
+            static_cast<unsigned __int128>(ticks) * mult >> 32);
+    }
+
+    // Nanoseconds in ticks after the anchor: slewed over the interval,
+    // at the measured rate past it
+    static std::int64_t elapsed(std::uint64_t ticks, std::uint64_t mult,
+                                std::uint64_t rate,
+                                std::uint64_t interval) noexcept
+    {
+        if(ticks <= interval) [[likely]]
+            return scale(ticks, mult);
+        return scale(interval, mult) + scale(ticks - interval, rate);
+    }
+
+    // The calibration is a seqlock: readers retry while it changes
+    std::int64_t read() noexcept
+    {
+        for(;;)
+        {
+            auto sequence = _sequence.load(std::memory_order_acquire);
+            auto tsc = _tsc.load(std::memory_order_relaxed);
+            auto ns = _ns.load(std::memory_order_relaxed);
+            auto mult = _mult.load(std::memory_order_relaxed);
+            auto rate = _rate.load(std::memory_order_relaxed);
+            auto interval = _intervalTicks.load(std::memory_order_relaxed);
+            // Counted before the check, so a recalibration that passes it
+            // samples a later count
+            auto counter = __rdtsc();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if((sequence & 1) ||
+               sequence != _sequence.load(std::memory_order_relaxed))
+                continue;
+
+            auto ticks = counter - tsc;
+            // Read before another thread recalibrated at a later count
+            if(static_cast<std::int64_t>(ticks) < 0)
+                return ns;
+            if(ticks <= interval) [[likely]]
+                return ns + scale(ticks, mult);
+            auto recalibrated = recalibrate();
+            if(!_reliable.load(std::memory_order_relaxed))
+                return fallbackNs();
+            if(!recalibrated)
+                return ns + elapsed(ticks, mult, rate, interval);
+        }
+    }
+
+    // Returns false if another thread is recalibrating already
+    [[gnu::noinline]] bool recalibrate() noexcept
+    {
+        auto sequence = _sequence.load(std::memory_order_relaxed);
+        if((sequence & 1) ||
+           !_sequence.compare_exchange_strong(sequence, sequence + 1,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed))
+            return false;
+        std::atomic_thread_fence(std::memory_order_release);
+
+        auto [counter, ns] = sample();
+        auto tsc = _tsc.load(std::memory_order_relaxed);
+        auto anchor = _ns.load(std::memory_order_relaxed);
+        auto mult = _mult.load(std::memory_order_relaxed);
+        auto rate = _rate.load(std::memory_order_relaxed);
+        auto interval = _intervalTicks.load(std::memory_order_relaxed);
+        auto predicted =
+            anchor + elapsed(counter - tsc, mult, rate, interval);
+        // NTP may slew steady_clock itself by up to 500ppm
+        const auto maxDrift =
+            std::chrono::nanoseconds(kMaxDrift).count() + (ns - anchor) / 2000;
+        if(counter <= tsc || predicted - ns > maxDrift ||
+           ns - predicted > maxDrift)
+        {
+            _floor.store(predicted, std::memory_order_relaxed);
+            _reliable.store(false, std::memory_order_relaxed);
+        }
+        else
+            calibrate(counter, std::max(predicted, ns), ns, systemNs());
+
+        _sequence.store(sequence + 2, std::memory_order_release);
+        return true;
+    }
+
+    // Anchor the clock at anchor nanoseconds for counter, where steady_clock
+    // read ns. The rate is chosen to meet steady_clock again one interval
+    // later, but at least half the measured one when the clock is ahead.
+    void calibrate(std::uint64_t counter, std::int64_t anchor, std::int64_t ns,
+                   std::int64_t wall) noexcept
+    {
+        const auto intervalNs =
+            std::chrono::nanoseconds(kRecalibrationInterval).count();
+        auto rate = static_cast<std::uint64_t>(
+            (static_cast<unsigned __int128>(ns - _startNs) << 32) /
+            (counter - _startTsc));
+        auto intervalTicks = static_cast<std::uint64_t>(
+            (static_cast<unsigned __int128>(intervalNs) << 32) / rate);
+        auto catchUp = std::max(ns + intervalNs - anchor, intervalNs / 2);
+        auto mult = static_cast<std::uint64_t>(
+            (static_cast<unsigned __int128>(catchUp) << 32) / intervalTicks);
+
+        _tsc.store(counter, std::memory_order_relaxed);
+        _ns.store(anchor, std::memory_order_relaxed);
+        _mult.store(mult, std::memory_order_relaxed);
+        _rate.store(rate, std::memory_order_relaxed);
+        _intervalTicks.store(intervalTicks, std::memory_order_relaxed);
+        _wallOffset.store(wall - ns, std::memory_order_relaxed);
+    }
+#endif
+
+    alignas(64) std::atomic<std::uint32_t> _sequence{0};
+    std::atomic<bool> _reliable{false};
+    std::atomic<std::uint64_t> _tsc{0};
+    std::atomic<std::int64_t> _ns{0};
+    std::atomic<std::uint64_t> _mult{0};
+    std::atomic<std::uint64_t> _rate{0};
+    std::atomic<std::uint64_t> _intervalTicks{0};
+    std::atomic<std::int64_t> _wallOffset{0};
+    // Time handed out last before falling back to steady_clock
+    std::atomic<std::int64_t> _floor{0};
+
+    // Only touched while holding the sequence
+    std::uint64_t _startTsc = 0;
+    std::int64_t _startNs = 0;
+};
+
+} // namespace mla::clock
+
+#endif
@@ -2,16 +2,112 @@
 #define __MLA_COMMON_H__
 
 #include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace mla {
 
+// Process-wide unique 64-bit ids. Every thread takes a block of
+// kIdBlockSize ids from the shared counter at a time, so the counter's
+// cache line is touched once per block instead of once per id. Ids are
+// unique but only increasing within a thread. Routed ids are a separate
+// id space: they are unique among themselves, but may equal getId() ones.
 struct Id
 {
-    [[nodiscard]] static auto getId() -> unsigned
+    static constexpr std::uint64_t kIdBlockSize = 4096;
+
+    // Routed ids: [shard:8][thread:16][sequence:40]
+    static constexpr unsigned kSequenceBits = 40;
+    static constexpr unsigned kThreadBits = 16;
+
+    [[nodiscard]] static auto getId() -> std::uint64_t
+    {
+        static std::atomic<std::uint64_t> next {0};
+        thread_local std::uint64_t id = 0;
+        thread_local std::uint64_t end = 0;
+
+        [[unlikely]] if(id == end)
+        {
+            id = next.fetch_add(kIdBlockSize, std::memory_order_relaxed);
+            end = id + kIdBlockSize;
+        }
+        return id++;
+    }
+
+    // Id carrying shard and the calling thread's index, e.g. to route a
+    // reply back to its origin. Needs no shared counter at all after the
+    // thread's first call. A thread index is given back when its thread
+    // exits and the next thread taking it continues its sequence, so ids
+    // only repeat after 2^40 of them per index. Throws if 2^16 threads
+    // that called it are alive at once.
+    [[nodiscard]] static auto getRoutedId(std::uint8_t shard) -> std::uint64_t
     {
-        static std::atomic<unsigned> id {0};
-        return id.fetch_add(1, std::memory_order_relaxed);
+        thread_local RoutedThread slot;
+
+        return std::uint64_t{shard} << (kSequenceBits + kThreadBits) |
+               slot.thread << kSequenceBits |
+               (slot.sequence++ & ((std::uint64_t{1} << kSequenceBits) - 1));
+    }
+
+    [[nodiscard]] static auto shardOf(std::uint64_t id) -> std::uint8_t
+    {
+        return static_cast<std::uint8_t>(id >> (kSequenceBits + kThreadBits));
     }
+
+    [[nodiscard]] static auto threadOf(std::uint64_t id) -> std::uint16_t
+    {
+        return static_cast<std::uint16_t>(id >> kSequenceBits);
+    }
+
+private:
+    // Thread indexes not owned by a thread, with the sequence to go on from
+    struct RoutedThreads
+    {
+        std::mutex mutex;
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> free;
+        std::uint64_t next = 0;
+    };
+
+    static RoutedThreads& routedThreads()
+    {
+        static RoutedThreads threads;
+        return threads;
+    }
+
+    struct RoutedThread
+    {
+        RoutedThread()
+        {
+            auto& threads = routedThreads();
+            std::lock_guard lock(threads.mutex);
+            if(!threads.free.empty())
+            {
+                std::tie(thread, sequence) = threads.free.back();
+                threads.free.pop_back();
+            }
+            else if(threads.next < (std::uint64_t{1} << kThreadBits))
+                thread = threads.next++;
+            else
+                throw std::runtime_error("Too many threads with routed ids");
+        }
+
+        ~RoutedThread()
+        {
+            auto& threads = routedThreads();
+            std::lock_guard lock(threads.mutex);
+            threads.free.emplace_back(thread, sequence);
+        }
+
+        RoutedThread(const RoutedThread&) = delete;
+        RoutedThread& operator=(const RoutedThread&) = delete;
+
+        std::uint64_t thread = 0;
+        std::uint64_t sequence = 0;
+    };
 };
 
 }
@@ -0,0 +1,122 @@
+#ifndef __MLA_DETAIL_BITMAPUTIL__
+#define __MLA_DETAIL_BITMAPUTIL__
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace detail::util
+{
+
+static constexpr std::size_t kBitsPerWord = 64;
+
+constexpr std::size_t bitmap_words(std::size_t bits)
+{
+    return (bits + kBitsPerWord - 1) / kBitsPerWord;
+}
+
+constexpr void set_bit(std::uint64_t* words, std::size_t bit)
+{
+    words[bit / kBitsPerWord] |= std::uint64_t{1} << (bit % kBitsPerWord);
+}
+
+constexpr void clear_bit(std::uint64_t* words, std::size_t bit)
+{
+    words[bit / kBitsPerWord] &= ~(std::uint64_t{1} << (bit % kBitsPerWord));
+}
+
+constexpr bool test_bit(const std::uint64_t* words, std::size_t bit)
+{
+    return (words[bit / kBitsPerWord] >> (bit % kBitsPerWord)) & 1;
+}
+
+// Index of the first set bit in [from, bits), or bits if there is none.
+// Skips empty words 64 slots at a time.
+constexpr std::size_t next_set_bit(const std::uint64_t* words,
+                                   std::size_t bits, std::size_t from)
+{
+    if(from >= bits)
+        return bits;
+
+    std::size_t word = from / kBitsPerWord;
+    std::uint64_t current = words[word] & (~std::uint64_t{0}
+                                           << (from % kBitsPerWord));
+    const std::size_t last = bitmap_words(bits);
+    while(current == 0)
+    {
+        if(++word == last)
+            return bits;
+        current = words[word];
+    }
+    return std::min(word * kBitsPerWord +
+                        static_cast<std::size_t>(std::countr_zero(current)),
+                    bits);
+}
+
+// Split [0, bits) into word-aligned ranges and call fn(begin, end) for each
+// one on its own thread. The last range runs on the calling thread. The
+// first exception thrown by fn is rethrown once all ranges are done.
+template <typename Fn>
+void parallel_ranges(std::size_t bits, unsigned num_threads, Fn&& fn)
+{
+    const std::size_t words = bitmap_words(bits);
+    num_threads = static_cast<unsigned>(
+        std::clamp<std::size_t>(num_threads, 1, std::max<std::size_t>(words, 1)));
+    const std::size_t words_per_range =
+        (words + num_threads - 1) / num_threads;
+
+    std::vector<std::exception_ptr> errors(num_threads);
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(num_threads - 1);
+        for(unsigned i = 0; i + 1 < num_threads; ++i)
+        {
+            const std::size_t begin = i * words_per_range * kBitsPerWord;
+            const std::size_t end =
+                std::min((i + 1) * words_per_range * kBitsPerWord, bits);
+            if(begin < end)
+            {
+                workers.emplace_back(
+                    [&fn, &error = errors[i], begin, end]
+                    {
+                        try
+                        {
+                            fn(begin, end);
+                        }
+                        catch(...)
+                        {
+                            error = std::current_exception();
+                        }
+                    });
+            }
+        }
+
+        const std::size_t begin =
+            std::min((num_threads - 1) * words_per_range * kBitsPerWord, bits);
+        if(begin < bits)
+        {
+            try
+            {
+                fn(begin, bits);
+            }
+            catch(...)
+            {
+                errors.back() = std::current_exception();
+            }
+        }
+    }
+
+    for(const auto& error : errors)
+    {
+        if(error)
+            std::rethrow_exception(error);
+    }
+}
+
+} // namespace detail::util
+
+#endif
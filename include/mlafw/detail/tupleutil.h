@@ -1,6 +1,10 @@
 #ifndef __MLA_DETAIL_TUPLEUTIL__
 #define __MLA_DETAIL_TUPLEUTIL__
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <sstream>
 #include <tuple>
 #include <type_traits>
@@ -43,6 +47,69 @@ inline constexpr std::size_t find_type_index_v = find_type_index<T, Tuple>::valu
 template <typename T, typename... Us>
 concept contains_type = (std::same_as<T, Us> || ...);
 
+// Index of T in Ts..., or sizeof...(Ts) if T is not there
+template <typename T, typename... Ts>
+inline constexpr std::size_t type_index_v = []
+{
+    std::size_t index = 0;
+    (void)((std::is_same_v<T, Ts> ? false : (++index, true)) && ...);
+    return index;
+}();
+
+// Offsets of Ts... packed into one buffer. Fields are placed by decreasing
+// alignment, in declaration order otherwise, so none of them needs padding.
+template <typename... Ts>
+struct packed_layout
+{
+    static constexpr std::size_t count = sizeof...(Ts);
+
+    static constexpr std::size_t alignment =
+        std::max({std::size_t{1}, alignof(Ts)...});
+
+    static constexpr std::array<std::size_t, count> offsets = []
+    {
+        constexpr std::array<std::size_t, count> sizes{sizeof(Ts)...};
+        constexpr std::array<std::size_t, count> aligns{alignof(Ts)...};
+
+        std::array<std::size_t, count> order{};
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            std::size_t j = i;
+            for(; j > 0 && aligns[order[j - 1]] < aligns[i]; --j)
+                order[j] = order[j - 1];
+            order[j] = i;
+        }
+
+        std::array<std::size_t, count> result{};
+        std::size_t offset = 0;
+        for(auto i : order)
+        {
+            offset = (offset + aligns[i] - 1) / aligns[i] * aligns[i];
+            result[i] = offset;
+            offset += sizes[i];
+        }
+        return result;
+    }();
+
+    // End of the last field
+    static constexpr std::size_t size = []
+    {
+        constexpr std::array<std::size_t, count> sizes{sizeof(Ts)...};
+        std::size_t end = 0;
+        for(std::size_t i = 0; i < count; ++i)
+            end = std::max(end, offsets[i] + sizes[i]);
+        return end;
+    }();
+};
+
+// Smallest unsigned integer with a bit for each of n fields
+template <std::size_t N>
+using presence_mask_t = std::conditional_t<
+    N <= 8, std::uint8_t,
+    std::conditional_t<N <= 16, std::uint16_t,
+                       std::conditional_t<N <= 32, std::uint32_t,
+                                          std::uint64_t>>>;
+
 // General case for printing other types
 template <typename T>
 void print_element(std::ostream& os, const T& t)
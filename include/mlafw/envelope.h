@@ -0,0 +1,226 @@
+#ifndef __MLA_ENVELOPE_H__
+#define __MLA_ENVELOPE_H__
+
+#include "detail/tupleutil.h"
+#include "objectpool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace mla::thread {
+
+static constexpr std::size_t kEnvelopeInlineSize = 48;
+
+// Opt-in for small handle types that are cheap to move and own no memory
+// themselves, such as Request<T>, to be stored inline
+template<typename T>
+inline constexpr bool enable_inline_payload_v = false;
+
+// Small trivially copyable payloads are stored in place. Everything else,
+// in particular payloads owning heap memory such as std::string, travels as
+// a Pooled<T> handle from the producer's ObjectPool so that the object and
+// its capacity are recycled instead of reallocated for every message.
+template<typename T>
+inline constexpr bool fits_inline_v =
+    sizeof(T) <= kEnvelopeInlineSize &&
+    (std::is_trivially_copyable_v<T> ||
+     (enable_inline_payload_v<T> && std::is_nothrow_move_constructible_v<T>));
+
+template<typename T>
+using envelope_slot_t = std::conditional_t<fits_inline_v<T>, T, Pooled<T>>;
+
+// Event type for EventThread with a closed set of payload types, like
+// std::variant, but never bigger than its inline storage. Moving an envelope
+// through the queue moves either the small payload or a pool handle, so the
+// send/dispatch path does not allocate once the producer's pools are warm.
+// A default-constructed envelope is empty and is not dispatched.
+template<typename... Ts>
+class Envelope
+{
+    static constexpr std::size_t kStorageSize =
+        std::max({sizeof(envelope_slot_t<Ts>)...});
+    static constexpr std::uint32_t kEmpty = sizeof...(Ts);
+
+    template<typename T>
+    static constexpr std::uint32_t index_of =
+        detail::util::type_index_v<T, Ts...>;
+
+public:
+    Envelope() = default;
+
+    template<typename T, typename U = std::remove_cvref_t<T>>
+        requires(detail::util::contains_type<U, Ts...> && fits_inline_v<U>)
+    Envelope(T&& value) : _index(index_of<U>)
+    {
+        ::new(storage) U(std::forward<T>(value));
+    }
+
+    template<typename T>
+        requires detail::util::contains_type<T, Ts...>
+    Envelope(Pooled<T>&& value) : _index(index_of<T>)
+    {
+        static_assert(!fits_inline_v<T>,
+                      "Inline payloads are passed by value, not pooled");
+        ::new(storage) Pooled<T>(std::move(value));
+    }
+
+    Envelope(Envelope&& other) noexcept
+    {
+        moveFrom(other);
+    }
+
+    Envelope& operator=(Envelope&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    Envelope(const Envelope&) = delete;
+    Envelope& operator=(const Envelope&) = delete;
+
+    ~Envelope()
+    {
+        reset();
+    }
+
+    [[nodiscard]] std::size_t index() const
+    {
+        return _index;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return _index == kEmpty;
+    }
+
+    template<typename T>
+    [[nodiscard]] bool holds() const
+    {
+        return _index == index_of<T>;
+    }
+
+    // Pointer to the payload if it holds a T, nullptr otherwise
+    template<typename T>
+    [[nodiscard]] const T* get_if() const
+    {
+        if(!holds<T>())
+            return nullptr;
+        return &payload<T>();
+    }
+
+    // Call fn with the payload. Does nothing for an empty envelope.
+    template<typename Fn>
+    void visit(Fn&& fn) const
+    {
+        visitIndex([&]<typename T>(const envelope_slot_t<T>&)
+                   { fn(payload<T>()); });
+    }
+
+    template<typename Fn>
+    void visit(Fn&& fn)
+    {
+        visitIndex([&]<typename T>(envelope_slot_t<T>&)
+                   { fn(payload<T>()); });
+    }
+
+    void reset()
+    {
+        visitIndex([this]<typename T>(envelope_slot_t<T>& slot)
+                   { std::destroy_at(&slot); });
+        _index = kEmpty;
+    }
+
+private:
+    template<typename T>
+    const envelope_slot_t<T>& slot() const
+    {
+        return *std::launder(
+            reinterpret_cast<const envelope_slot_t<T>*>(storage));
+    }
+
+    template<typename T>
+    envelope_slot_t<T>& slot()
+    {
+        return *std::launder(reinterpret_cast<envelope_slot_t<T>*>(storage));
+    }
+
+    template<typename T>
+    const T& payload() const
+    {
+        if constexpr(fits_inline_v<T>)
+            return slot<T>();
+        else
+            return *slot<T>();
+    }
+
+    template<typename T>
+    T& payload()
+    {
+        if constexpr(fits_inline_v<T>)
+            return slot<T>();
+        else
+            return *slot<T>();
+    }
+
+    // Call fn.template operator()<T>(slot) for the stored alternative,
+    // with slot as const as the envelope
+    template<typename Fn>
+    void visitIndex(Fn&& fn) const
+    {
+        visitIndexOf(*this, fn);
+    }
+
+    template<typename Fn>
+    void visitIndex(Fn&& fn)
+    {
+        visitIndexOf(*this, fn);
+    }
+
+    template<typename Self, typename Fn>
+    static void visitIndexOf(Self& self, Fn& fn)
+    {
+        [&]<std::size_t... Is>(std::index_sequence<Is...>)
+        {
+            (void)((self._index == Is
+                        ? (fn.template operator()<Ts>(
+                               self.template slot<Ts>()),
+                           true)
+                        : false) ||
+                   ...);
+        }(std::index_sequence_for<Ts...>{});
+    }
+
+    void moveFrom(Envelope& other)
+    {
+        other.visitIndex(
+            [this]<typename T>(envelope_slot_t<T>& slot)
+            {
+                using Slot = envelope_slot_t<T>;
+                ::new(storage) Slot(std::move(slot));
+            });
+        _index = other._index;
+        other.reset();
+    }
+
+    alignas(envelope_slot_t<Ts>...) std::byte storage[kStorageSize];
+    std::uint32_t _index = kEmpty;
+};
+
+template<typename T>
+inline constexpr bool is_envelope_v = false;
+
+template<typename... Ts>
+inline constexpr bool is_envelope_v<Envelope<Ts...>> = true;
+
+} // namespace mla::thread
+
+#endif // __MLA_ENVELOPE_H__
@@ -1,40 +1,187 @@
 #ifndef __MLA_EVENTTHREAD_H__
 #define __MLA_EVENTTHREAD_H__
 
+#include "envelope.h"
+#include "metrics.h"
+#include "objectpool.h"
+#include "request.h"
+#include "task.h"
 #include "thread.h"
 
-#include "blockingconcurrentqueue.h"
+#include "concurrentqueue.h"
+#include "lightweightsemaphore.h"
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
 namespace mla::thread {
 
 static constexpr int kDefaultQueueSize = 10000;
 
+// Initial capacity of the Control and Bulk lanes, which grow on demand
+static constexpr int kLaneQueueSize = 256;
+
+// Lanes of a BlockingEventQueue, highest priority first. Events keep their
+// order within a lane. Control is for shutdown, configuration changes,
+// cancellations and the like, which should not wait behind queued data;
+// Bulk is for data that may wait behind everything else.
+enum class Lane : std::uint8_t
+{
+    Control,
+    Default,
+    Bulk,
+};
+
+inline constexpr std::size_t kLanes = 3;
+
 template<typename EventType>
 class BlockingEventQueue
 {
 public:
+    using event_type = EventType;
+
     virtual ~BlockingEventQueue() = default;
 
     virtual void processEvent(const EventType& event) = 0;
 
-    void push(const EventType& event);
+    // Called by the event loop, which owns the event. Handlers that take
+    // the event by non-const reference may move parts of it out.
+    virtual void processEvent(EventType& event)
+    {
+        processEvent(std::as_const(event));
+    }
+
+    void push(const EventType& event, Lane lane = Lane::Default);
+
+    void push(EventType&& event, Lane lane = Lane::Default);
+
+    auto isLockFree() -> bool { return _lanes[0].is_lock_free(); }
 
-    void push(EventType&& event);
+    // The consumer takes from the highest lane that has events, so a
+    // Control event waits for at most the handler running when it comes
+    // in. Lower lanes get nothing while higher ones are busy. This is the
+    // default.
+    void setStrictPriority()
+    {
+        _weighted = false;
+    }
 
-    auto isLockFree() -> bool { return _queue.is_lock_free(); }
+    // The consumer takes up to weights[lane] events in a row from each lane
+    // in turn, skipping empty ones, so no lane starves. A Control event
+    // waits for at most the weights of the other lanes. Like
+    // setStrictPriority(), to be called before the consumer starts.
+    void setWeightedPriority(const std::array<std::uint32_t, kLanes>& weights)
+    {
+        for(auto weight : weights)
+        {
+            if(weight == 0)
+                throw std::runtime_error("Lane weights must not be zero");
+        }
+        _weights = weights;
+        _weighted = true;
+        _lane = 0;
+        _credit = _weights[0];
+    }
+
+    // Counters of this queue's consumer, readable from any thread. Only
+    // available when built with MLA_EVENT_METRICS.
+    [[nodiscard]] QueueMetricsSnapshot metrics() const
+        requires kEventMetrics
+    {
+        return _metrics.snapshot(sizeApprox());
+    }
 
     void eventLoop();
 
     void breakEventLoop();
 
 protected:
-    moodycamel::BlockingConcurrentQueue<
-        EventType,
-        moodycamel::ConcurrentQueueDefaultTraits> _queue {kDefaultQueueSize};
+    using queue_item = std::conditional_t<kEventMetrics,
+                                          StampedEvent<EventType>, EventType>;
+
+    void dispatch(queue_item& item);
+
+    // Next event by the lane priority, for consumers with a loop of their
+    // own
+    bool tryDequeue(queue_item& item)
+    {
+        if(!_items.tryWait())
+            return false;
+        // Counted events are in a lane already, if maybe not visible yet
+        while(!takeNext(item))
+        {
+        }
+        return true;
+    }
+
+    void waitDequeue(queue_item& item)
+    {
+        while(!_items.wait())
+        {
+        }
+        while(!takeNext(item))
+        {
+        }
+    }
+
+    [[nodiscard]] std::size_t sizeApprox() const
+    {
+        return _items.availableApprox();
+    }
+
+    // For queues whose consumer sleeps somewhere else than on _items, e.g.
+    // in epoll_wait(): with _wakeOnPush set, push() calls unpark() once
+    // after the consumer has set _parked
+    virtual void unpark() {}
+
+    void wakeIfParked()
+    {
+        // Pairs with the consumer's fence between setting _parked and
+        // checking sizeApprox() once more
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(_parked.load(std::memory_order_relaxed) && _parked.exchange(false))
+            unpark();
+    }
+
+    using lane_queue = moodycamel::ConcurrentQueue<
+        queue_item,
+        moodycamel::ConcurrentQueueDefaultTraits>;
+
+    // Indexed by Lane. _items counts the events in all of them, so the
+    // consumer sleeps on one semaphore.
+    std::array<lane_queue, kLanes> _lanes {lane_queue(kLaneQueueSize),
+                                           lane_queue(kDefaultQueueSize),
+                                           lane_queue(kLaneQueueSize)};
+    moodycamel::LightweightSemaphore _items;
+    // Events pushed to the Control and Bulk lanes and not taken yet; while
+    // there are none, the consumer takes from Default without a lane scan
+    std::atomic<std::size_t> _otherLanes{0};
 
     std::atomic_bool _isRunning{false};
+
+    bool _wakeOnPush = false;
+    std::atomic_bool _parked{false};
+
+    [[no_unique_address]] std::conditional_t<
+        kEventMetrics, QueueMetrics<EventType>, NoQueueMetrics> _metrics;
+
+private:
+    bool takeNext(queue_item& item);
+
+    bool takeFrom(std::size_t lane, queue_item& item);
+
+    // Lane policy; _lane and _credit are the consumer's position in the
+    // weighted round
+    bool _weighted = false;
+    std::array<std::uint32_t, kLanes> _weights {};
+    std::size_t _lane = 0;
+    std::uint32_t _credit = 0;
 };
 
 template <typename Owner, typename EventType>
@@ -55,19 +202,95 @@ public:
     }
 
     void processEvent(const EventType& event) override;
+
+    void processEvent(EventType& event) override;
+
+    // Send message to target as a Request<T>; the answer comes back to this
+    // thread as a Reply<T> event
+    template<typename T, typename Target>
+    void request(Target& target, Pooled<T>&& message)
+    {
+        target.push(typename Target::event_type{
+            Request<T>(std::move(message), *this)});
+    }
+
+    // Scheduler that resumes coroutines through this thread's queue.
+    // EventType must accept Resume.
+    [[nodiscard]] Scheduler scheduler()
+    {
+        return {this, [](void* self, std::coroutine_handle<> handle)
+                {
+                    static_cast<EventThread*>(self)->push(
+                        EventType{Resume{handle}});
+                }};
+    }
+
+    // Run t detached on this thread. It starts from the event loop, and
+    // everything it awaits resumes there as well.
+    void spawn(task<> t)
+    {
+        auto handle = t.release();
+        handle.promise().scheduler = scheduler();
+        handle.promise().detached = true;
+        this->push(EventType{Resume{handle}});
+    }
 };
 
+// Call owner->onEvent() with the alternative held by event. Resume events
+// continue their coroutine instead.
+template<typename Owner, typename EventType>
+void dispatchEvent(Owner* owner, EventType& event)
+{
+    auto dispatch = [owner](auto& e)
+    {
+        if constexpr(std::is_same_v<std::decay_t<decltype(e)>, Resume>)
+            e.handle.resume();
+        else
+            owner->onEvent(e);
+    };
+
+    if constexpr(is_envelope_v<EventType>)
+        event.visit(dispatch);
+    else
+        std::visit(dispatch, event);
+}
+
 // BlockingEventQueue implementation
 template<typename EventType>
-void BlockingEventQueue<EventType>::push(const EventType& event)
+void BlockingEventQueue<EventType>::push(const EventType& event, Lane lane)
 {
-    _queue.enqueue(event);
+    auto& queue = _lanes[static_cast<std::size_t>(lane)];
+    // Raised before the event is counted in _items, so a consumer that
+    // took its count sees it
+    if(lane != Lane::Default)
+        _otherLanes.fetch_add(1, std::memory_order_relaxed);
+    if constexpr(kEventMetrics)
+        queue.enqueue(queue_item{event, QueueMetrics<EventType>::now()});
+    else
+        queue.enqueue(event);
+    _items.signal();
+
+    [[unlikely]] if(_wakeOnPush)
+        wakeIfParked();
 }
 
 template<typename EventType>
-void BlockingEventQueue<EventType>::push(EventType&& event)
+void BlockingEventQueue<EventType>::push(EventType&& event, Lane lane)
 {
-    _queue.enqueue(std::move(event));
+    auto& queue = _lanes[static_cast<std::size_t>(lane)];
+    // Raised before the event is counted in _items, so a consumer that
+    // took its count sees it
+    if(lane != Lane::Default)
+        _otherLanes.fetch_add(1, std::memory_order_relaxed);
+    if constexpr(kEventMetrics)
+        queue.enqueue(
+            queue_item{std::move(event), QueueMetrics<EventType>::now()});
+    else
+        queue.enqueue(std::move(event));
+    _items.signal();
+
+    [[unlikely]] if(_wakeOnPush)
+        wakeIfParked();
 }
 
 template<typename EventType>
@@ -77,30 +300,118 @@ void BlockingEventQueue<EventType>::eventLoop()
 
     while(true)
     {
-        EventType evt;
-        _queue.wait_dequeue(evt);
-        processEvent(evt);
+        queue_item item;
+        waitDequeue(item);
+        dispatch(item);
 
         [[unlikely]] if(!_isRunning.load())
             break;
     }
 }
 
+template<typename EventType>
+void BlockingEventQueue<EventType>::dispatch(queue_item& item)
+{
+    if constexpr(kEventMetrics)
+    {
+        using Metrics = QueueMetrics<EventType>;
+        const auto start = Metrics::now();
+        const auto index = Metrics::indexOf(item.event);
+        _metrics.recordWait(Metrics::elapsed(item.enqueuedNs, start));
+        processEvent(item.event);
+        _metrics.recordHandler(index, Metrics::elapsed(start, Metrics::now()));
+    }
+    else
+    {
+        processEvent(item);
+    }
+}
+
+template<typename EventType>
+bool BlockingEventQueue<EventType>::takeNext(queue_item& item)
+{
+    constexpr auto kDefault = static_cast<std::size_t>(Lane::Default);
+
+    // Synchronized by _items with the pushes counted so far. With the
+    // other lanes empty, a weighted round starts over at the next event
+    // pushed to them.
+    if(_otherLanes.load(std::memory_order_relaxed) == 0)
+    {
+        _lane = 0;
+        _credit = _weights[0];
+        return _lanes[kDefault].try_dequeue(item);
+    }
+
+    if(!_weighted)
+    {
+        for(std::size_t lane = 0; lane < kLanes; ++lane)
+        {
+            if(takeFrom(lane, item))
+                return true;
+        }
+        return false;
+    }
+
+    for(std::size_t tried = 0; tried <= kLanes; ++tried)
+    {
+        if(_credit > 0 && takeFrom(_lane, item))
+        {
+            --_credit;
+            return true;
+        }
+        _lane = (_lane + 1) % kLanes;
+        _credit = _weights[_lane];
+    }
+    return false;
+}
+
+template<typename EventType>
+bool BlockingEventQueue<EventType>::takeFrom(std::size_t lane,
+                                             queue_item& item)
+{
+    if(!_lanes[lane].try_dequeue(item))
+        return false;
+    if(lane != static_cast<std::size_t>(Lane::Default))
+        _otherLanes.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
 template<typename EventType>
 void BlockingEventQueue<EventType>::breakEventLoop()
 {
     _isRunning.store(false);
 
-    // Enqueue a dump object just to make event loop exit.
-    // Queue does not support notify.. Maybe fix this later
-    _queue.enqueue(EventType{});
+    // Enqueue a dump object just to make event loop exit, ahead of any
+    // queued events. Queue does not support notify.. Maybe fix this later
+    push(EventType{}, Lane::Control);
 }
 
 template<typename Owner, typename EventType>
 void EventThread<Owner, EventType>::processEvent(const EventType& event)
 {
     auto* owner = static_cast<Owner*>(this);
-    std::visit([&](const auto& e) { owner->onEvent(e); }, event);
+    auto dispatch = [owner](const auto& e)
+    {
+        // Handlers taking a mutable event, e.g. to reply to a Request, can
+        // only be reached through the event loop
+        if constexpr(std::is_same_v<std::decay_t<decltype(e)>, Resume>)
+            e.handle.resume();
+        else if constexpr(requires { owner->onEvent(e); })
+            owner->onEvent(e);
+        else
+            throw std::logic_error("Event handler requires a mutable event");
+    };
+
+    if constexpr(is_envelope_v<EventType>)
+        event.visit(dispatch);
+    else
+        std::visit(dispatch, event);
+}
+
+template<typename Owner, typename EventType>
+void EventThread<Owner, EventType>::processEvent(EventType& event)
+{
+    dispatchEvent(static_cast<Owner*>(this), event);
 }
 
 } // namespace mla::thread
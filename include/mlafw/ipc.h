@@ -0,0 +1,587 @@
+#ifndef __MLA_IPC_H__
+#define __MLA_IPC_H__
+
+#include "eventthread.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace mla::ipc {
+
+// How events cross the process boundary. Trivially copyable events are
+// copied as they are; specialize for others, e.g. with encode() from
+// attributewire.h.
+template<typename T>
+struct codec
+{
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Specialize mla::ipc::codec for this event");
+
+    static constexpr std::size_t max_size = sizeof(T);
+
+    static std::size_t encode(const T& value, std::span<std::byte> out)
+    {
+        std::memcpy(out.data(), &value, sizeof(T));
+        return sizeof(T);
+    }
+
+    static T decode(std::span<const std::byte> in)
+    {
+        T value;
+        std::memcpy(&value, in.data(), sizeof(T));
+        return value;
+    }
+};
+
+// Bounded ring of messages in shared memory, for any number of producers
+// in any processes and one consumer. Slots hand over in place, so a
+// message is written and read once each. The consumer sleeps on a futex
+// that producers only touch while it is asleep; producers finding the
+// ring full sleep on another one until the consumer frees a slot.
+class SharedRing
+{
+    static constexpr std::uint64_t kMagic = 0x4d4c41524e473031; // MLARNG01
+
+    struct Header
+    {
+        std::atomic<std::uint64_t> magic;
+        std::uint32_t capacity;
+        std::uint32_t slotSize;
+        std::uint32_t stride;
+
+        alignas(64) std::atomic<std::uint64_t> tail;
+        alignas(64) std::atomic<std::uint64_t> head;
+        alignas(64) std::atomic<std::uint32_t> wakeups;
+        std::atomic<std::uint32_t> sleeping;
+        alignas(64) std::atomic<std::uint32_t> freed;
+        std::atomic<std::uint32_t> waiting;
+    };
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> sequence;
+        std::uint32_t size;
+    };
+
+    static constexpr std::size_t kDataOffset = 16;
+
+    // Size of a slot given up by a producer, which the consumer skips
+    static constexpr std::uint32_t kAbandoned = ~std::uint32_t{0};
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                      std::atomic<std::uint32_t>::is_always_lock_free,
+                  "Shared memory needs address-free atomics");
+    static_assert(sizeof(Slot) <= kDataOffset);
+
+public:
+    // Named ring under /dev/shm; fails if name exists. capacity is rounded
+    // up to a power of two.
+    static SharedRing create(const std::string& name, std::uint32_t capacity,
+                             std::uint32_t slotSize)
+    {
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if(fd < 0)
+            fail("Cannot create shared ring " + name);
+        return SharedRing(fd, capacity, slotSize);
+    }
+
+    static SharedRing open(const std::string& name)
+    {
+        int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+        if(fd < 0)
+            fail("Cannot open shared ring " + name);
+        return SharedRing(fd);
+    }
+
+    static void unlink(const std::string& name)
+    {
+        ::shm_unlink(name.c_str());
+    }
+
+    // Ring without a name, shared through fd(): inherited over fork() or
+    // passed with SCM_RIGHTS, then attach()ed
+    static SharedRing anonymous(std::uint32_t capacity, std::uint32_t slotSize)
+    {
+        int fd = ::memfd_create("mla-shared-ring", MFD_CLOEXEC);
+        if(fd < 0)
+            fail("Cannot create shared ring");
+        return SharedRing(fd, capacity, slotSize);
+    }
+
+    // Map the ring behind fd, which the SharedRing takes over
+    static SharedRing attach(int fd)
+    {
+        return SharedRing(fd);
+    }
+
+    SharedRing(SharedRing&& other) noexcept
+        : _fd(std::exchange(other._fd, -1)),
+          _size(std::exchange(other._size, 0)),
+          _header(std::exchange(other._header, nullptr))
+    {
+    }
+
+    SharedRing& operator=(SharedRing&& other) noexcept
+    {
+        if(this != &other)
+        {
+            close();
+            _fd = std::exchange(other._fd, -1);
+            _size = std::exchange(other._size, 0);
+            _header = std::exchange(other._header, nullptr);
+        }
+        return *this;
+    }
+
+    SharedRing(const SharedRing&) = delete;
+    SharedRing& operator=(const SharedRing&) = delete;
+
+    ~SharedRing()
+    {
+        close();
+    }
+
+    [[nodiscard]] int fd() const
+    {
+        return _fd;
+    }
+
+    [[nodiscard]] std::uint32_t capacity() const
+    {
+        return _header->capacity;
+    }
+
+    [[nodiscard]] std::uint32_t slotSize() const
+    {
+        return _header->slotSize;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        auto head = _header->head.load(std::memory_order_relaxed);
+        return slot(head).sequence.load(std::memory_order_acquire) !=
+               head + 1;
+    }
+
+    // Write a message with write(std::span<std::byte>), which returns its
+    // size. Returns false if the ring is full.
+    template<typename Fn>
+    bool tryPush(Fn&& write)
+    {
+        auto position = _header->tail.load(std::memory_order_relaxed);
+        Slot* target;
+        while(true)
+        {
+            target = &slot(position);
+            auto sequence = target->sequence.load(std::memory_order_acquire);
+            auto lag = static_cast<std::int64_t>(sequence - position);
+            if(lag == 0)
+            {
+                if(_header->tail.compare_exchange_weak(
+                       position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(lag < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = _header->tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        // The slot is taken, so it is published abandoned rather than lost
+        // when the message does not make it into the slot
+        std::size_t size;
+        try
+        {
+            size = write(std::span(data(*target), slotSize()));
+        }
+        catch(...)
+        {
+            target->size = kAbandoned;
+            target->sequence.store(position + 1, std::memory_order_release);
+            throw;
+        }
+        [[unlikely]] if(size > slotSize())
+        {
+            target->size = kAbandoned;
+            target->sequence.store(position + 1, std::memory_order_release);
+            throw std::runtime_error("Message too large for shared ring");
+        }
+        target->size = static_cast<std::uint32_t>(size);
+        target->sequence.store(position + 1, std::memory_order_release);
+        wakeConsumer();
+        return true;
+    }
+
+    // Like tryPush(), sleeping while the ring is full
+    template<typename Fn>
+    void push(Fn&& write)
+    {
+        while(!tryPush(write))
+        {
+            auto freed = _header->freed.load(std::memory_order_acquire);
+            _header->waiting.fetch_add(1);
+            if(full())
+                futexWait(_header->freed, freed);
+            _header->waiting.fetch_sub(1);
+        }
+    }
+
+    bool tryPush(std::span<const std::byte> message)
+    {
+        return tryPush(
+            [message](std::span<std::byte> out)
+            {
+                std::copy_n(message.begin(),
+                            std::min(message.size(), out.size()),
+                            out.begin());
+                return message.size();
+            });
+    }
+
+    // Consumer only: call read(std::span<const std::byte>) with the next
+    // message, skipping slots given up by a failed push. Returns false if
+    // the ring is empty.
+    template<typename Fn>
+    bool tryPop(Fn&& read)
+    {
+        while(true)
+        {
+            auto head = _header->head.load(std::memory_order_relaxed);
+            auto& next = slot(head);
+            if(next.sequence.load(std::memory_order_acquire) != head + 1)
+                return false;
+
+            const auto size = next.size;
+            if(size != kAbandoned)
+                read(std::span<const std::byte>(data(next), size));
+            release(next, head);
+            if(size != kAbandoned)
+                return true;
+        }
+    }
+
+    // Consumer only: sleep until a message is pushed or wake() is called,
+    // unless the ring has one already or ready() returns true. ready() is
+    // for other sources of work the consumer has raised its flags for.
+    template<typename Ready>
+    void wait(Ready&& ready)
+    {
+        auto wakeups = _header->wakeups.load(std::memory_order_acquire);
+        _header->sleeping.store(1, std::memory_order_relaxed);
+        // Pairs with the fence in wakeConsumer()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(empty() && !ready())
+            futexWait(_header->wakeups, wakeups);
+        _header->sleeping.store(0, std::memory_order_relaxed);
+    }
+
+    void wait()
+    {
+        wait([] { return false; });
+    }
+
+    // Wake up the consumer, from any process
+    void wake()
+    {
+        _header->wakeups.fetch_add(1, std::memory_order_release);
+        futexWake(_header->wakeups, 1);
+    }
+
+private:
+    // New ring in the shared memory behind fd
+    SharedRing(int fd, std::uint32_t capacity, std::uint32_t slotSize)
+        : _fd(fd)
+    {
+        capacity = std::bit_ceil(std::max(capacity, 2u));
+        auto stride = static_cast<std::uint32_t>(
+            (kDataOffset + slotSize + 63) / 64 * 64);
+        _size = sizeof(Header) + std::size_t{capacity} * stride;
+        if(::ftruncate(_fd, static_cast<off_t>(_size)) < 0)
+            failClosing("Cannot size shared ring");
+        map();
+
+        _header->capacity = capacity;
+        _header->slotSize = slotSize;
+        _header->stride = stride;
+        for(std::uint32_t i = 0; i < capacity; ++i)
+            slot(i).sequence.store(i, std::memory_order_relaxed);
+        _header->magic.store(kMagic, std::memory_order_release);
+    }
+
+    // Existing ring behind fd
+    explicit SharedRing(int fd) : _fd(fd)
+    {
+        struct stat status;
+        if(::fstat(_fd, &status) < 0)
+            failClosing("Cannot open shared ring");
+        _size = static_cast<std::size_t>(status.st_size);
+        if(_size < sizeof(Header))
+        {
+            errno = EINVAL;
+            failClosing("Shared ring is not set up");
+        }
+        map();
+        if(_header->magic.load(std::memory_order_acquire) != kMagic)
+        {
+            errno = EINVAL;
+            failClosing("Shared ring is not set up");
+        }
+
+        // Slots are found by masking positions, and all of them must lie
+        // within the mapping
+        const auto capacity = _header->capacity;
+        const auto stride = _header->stride;
+        if(!std::has_single_bit(capacity) ||
+           stride < kDataOffset + std::size_t{_header->slotSize} ||
+           stride % alignof(Slot) != 0 ||
+           _size < sizeof(Header) + std::size_t{capacity} * stride)
+        {
+            errno = EINVAL;
+            failClosing("Shared ring is corrupt");
+        }
+    }
+
+    void map()
+    {
+        void* address = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, _fd, 0);
+        if(address == MAP_FAILED)
+            failClosing("Cannot map shared ring");
+        _header = static_cast<Header*>(address);
+    }
+
+    Slot& slot(std::uint64_t position) const
+    {
+        auto* slots = reinterpret_cast<std::byte*>(_header + 1);
+        return *reinterpret_cast<Slot*>(
+            slots + (position & (_header->capacity - 1)) * _header->stride);
+    }
+
+    static std::byte* data(Slot& slot)
+    {
+        return reinterpret_cast<std::byte*>(&slot) + kDataOffset;
+    }
+
+    // Hand the slot at head back to the producers
+    void release(Slot& slot, std::uint64_t head)
+    {
+        slot.sequence.store(head + capacity(), std::memory_order_release);
+        _header->head.store(head + 1, std::memory_order_relaxed);
+
+        // Pairs with waiting being raised before the producer looks at
+        // the ring again
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(_header->waiting.load(std::memory_order_relaxed) > 0)
+        {
+            _header->freed.fetch_add(1, std::memory_order_release);
+            futexWake(_header->freed, INT_MAX);
+        }
+    }
+
+    bool full() const
+    {
+        auto tail = _header->tail.load(std::memory_order_relaxed);
+        return static_cast<std::int64_t>(
+                   slot(tail).sequence.load(std::memory_order_acquire) -
+                   tail) < 0;
+    }
+
+    // Only the first producer after the consumer fell asleep wakes it, so
+    // the others do not pay for FUTEX_WAKE until it gets to run
+    void wakeConsumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(_header->sleeping.load(std::memory_order_relaxed) &&
+           _header->sleeping.exchange(0))
+            wake();
+    }
+
+    // Shared, not FUTEX_PRIVATE, as the word lives in another process too
+    static void futexWait(std::atomic<std::uint32_t>& word,
+                          std::uint32_t expected)
+    {
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+                  FUTEX_WAIT, expected, nullptr, nullptr, 0);
+    }
+
+    static void futexWake(std::atomic<std::uint32_t>& word, int count)
+    {
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+                  FUTEX_WAKE, count, nullptr, nullptr, 0);
+    }
+
+    [[noreturn]] static void fail(const std::string& what)
+    {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    [[noreturn]] void failClosing(const std::string& what)
+    {
+        auto message = what + ": " + std::strerror(errno);
+        close();
+        throw std::runtime_error(message);
+    }
+
+    void close()
+    {
+        if(_header)
+            ::munmap(_header, _size);
+        if(_fd >= 0)
+            ::close(_fd);
+        _header = nullptr;
+        _fd = -1;
+    }
+
+    int _fd = -1;
+    std::size_t _size = 0;
+    Header* _header = nullptr;
+};
+
+// Push target for an EventThread in another process that consumes ring,
+// e.g. a RingEventThread. Events are encoded straight into the ring's
+// slots with codec<EventType>.
+template<typename EventType>
+class RemoteQueue
+{
+public:
+    using event_type = EventType;
+
+    explicit RemoteQueue(SharedRing& ring) : _ring(ring)
+    {
+        if(codec<EventType>::max_size > ring.slotSize())
+            throw std::runtime_error("Events do not fit the shared ring");
+    }
+
+    // Sleeps while the ring is full
+    void push(const EventType& event)
+    {
+        _ring.push([&event](std::span<std::byte> out)
+                   { return codec<EventType>::encode(event, out); });
+    }
+
+    bool tryPush(const EventType& event)
+    {
+        return _ring.tryPush([&event](std::span<std::byte> out)
+                             { return codec<EventType>::encode(event, out); });
+    }
+
+private:
+    SharedRing& _ring;
+};
+
+} // namespace mla::ipc
+
+namespace mla::thread {
+
+// EventThread that also takes events from a SharedRing, pushed by other
+// processes through a RemoteQueue. It sleeps on the ring's futex, which
+// local push()es wake as well, so both kinds of events are dispatched on
+// this thread without a bridging thread.
+template<typename Owner, typename EventType>
+class RingEventThread : public EventThread<Owner, EventType>
+{
+    using queue_item = typename BlockingEventQueue<EventType>::queue_item;
+
+public:
+    // Events taken from each source before turning to the other one
+    static constexpr std::size_t kBatchSize = 64;
+
+    explicit RingEventThread(ipc::SharedRing& ring) : _ring(ring)
+    {
+        this->_wakeOnPush = true;
+    }
+
+    void execute() override
+    {
+        this->_isRunning.store(true);
+
+        while(true)
+        {
+            std::size_t handled = 0;
+            queue_item item;
+            while(handled < kBatchSize && this->tryDequeue(item))
+            {
+                this->dispatch(item);
+                ++handled;
+
+                [[unlikely]] if(!this->_isRunning.load())
+                    return;
+            }
+
+            std::size_t received = 0;
+            EventType event;
+            while(received < kBatchSize &&
+                  _ring.tryPop(
+                      [&event](std::span<const std::byte> in)
+                      { event = ipc::codec<EventType>::decode(in); }))
+            {
+                dispatchRemote(event);
+                ++received;
+
+                [[unlikely]] if(!this->_isRunning.load())
+                    return;
+            }
+
+            if(handled == 0 && received == 0)
+                park();
+        }
+    }
+
+protected:
+    void unpark() override
+    {
+        _ring.wake();
+    }
+
+private:
+    void park()
+    {
+        this->_parked.store(true, std::memory_order_relaxed);
+        _ring.wait([this] { return this->sizeApprox() > 0; });
+        this->_parked.store(false, std::memory_order_relaxed);
+    }
+
+    void dispatchRemote(EventType& event)
+    {
+        if constexpr(kEventMetrics)
+        {
+            // Time spent in the ring is not known
+            queue_item item{std::move(event),
+                            QueueMetrics<EventType>::now()};
+            this->dispatch(item);
+        }
+        else
+        {
+            this->dispatch(event);
+        }
+    }
+
+    ipc::SharedRing& _ring;
+};
+
+} // namespace mla::thread
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef __MLA_LOG_H__
 #define __MLA_LOG_H__
 
+#include "clock.h"
+
 #include <chrono>
 #include <format>
 #include <iomanip>
@@ -68,7 +70,7 @@ public:
 
     static std::string timestamp()
     {
-        auto now = std::chrono::system_clock::now();
+        auto now = clock::FastClock::wallNow();
         auto time = std::chrono::floor<std::chrono::microseconds>(now);
         auto ms = std::chrono::duration_cast<std::chrono::microseconds>(
                       time.time_since_epoch())
@@ -0,0 +1,178 @@
+#ifndef __MLA_MAPPEDQUICKMAP__
+#define __MLA_MAPPEDQUICKMAP__
+
+#include "vectorquickmap.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace mla
+{
+
+// Read-only view over a snapshot written by VectorQuickMap::dump(). The file
+// is mapped as-is and lookups probe the mapped entries directly, so opening
+// costs one mmap regardless of the number of entries.
+template <typename K, typename V>
+    requires(std::is_trivially_copyable_v<K> &&
+             std::is_trivially_copyable_v<V>)
+class MappedQuickMap
+{
+private:
+    using Entry = typename VectorQuickMap<K, V>::Entry;
+
+    void* base = nullptr;
+    size_t length = 0;
+    const Entry* data = nullptr;
+    size_t _capacity = 0;
+    size_t _size = 0;
+
+    size_t hash(const K& key) const
+    {
+        return std::hash<K>{}(key) % _capacity;
+    }
+
+    void release()
+    {
+        if(base)
+        {
+            ::munmap(base, length);
+            base = nullptr;
+        }
+    }
+
+public:
+    explicit MappedQuickMap(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+        {
+            throw std::runtime_error("Cannot open snapshot file: " + path);
+        }
+
+        constexpr size_t header_size = detail::util::kSnapshotHeaderSize;
+
+        struct stat st;
+        if(::fstat(fd, &st) != 0 ||
+           static_cast<size_t>(st.st_size) < header_size)
+        {
+            ::close(fd);
+            throw std::runtime_error("Invalid snapshot file: " + path);
+        }
+
+        length = static_cast<size_t>(st.st_size);
+        base = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(base == MAP_FAILED)
+        {
+            base = nullptr;
+            throw std::runtime_error("Cannot map snapshot file: " + path);
+        }
+
+        detail::util::QuickMapSnapshotHeader h;
+        std::memcpy(&h, base, sizeof(h));
+        if(h.magic != detail::util::QuickMapSnapshotHeader::kMagic ||
+           h.version != detail::util::QuickMapSnapshotHeader::kVersion ||
+           h.entry_size != sizeof(Entry) || h.key_size != sizeof(K) ||
+           h.value_size != sizeof(V) ||
+           h.capacity > (length - header_size) / sizeof(Entry) ||
+           length != header_size + h.capacity * sizeof(Entry) ||
+           h.size > h.capacity)
+        {
+            release();
+            throw std::runtime_error("Incompatible snapshot file: " + path);
+        }
+
+        data = reinterpret_cast<const Entry*>(static_cast<const char*>(base) +
+                                              header_size);
+        _capacity = h.capacity;
+        _size = h.size;
+    }
+
+    ~MappedQuickMap()
+    {
+        release();
+    }
+
+    MappedQuickMap(const MappedQuickMap&) = delete;
+    MappedQuickMap& operator=(const MappedQuickMap&) = delete;
+
+    MappedQuickMap(MappedQuickMap&& other) noexcept
+        : base(std::exchange(other.base, nullptr)),
+          length(std::exchange(other.length, 0)),
+          data(std::exchange(other.data, nullptr)),
+          _capacity(std::exchange(other._capacity, 0)),
+          _size(std::exchange(other._size, 0))
+    {
+    }
+
+    MappedQuickMap& operator=(MappedQuickMap&& other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            base = std::exchange(other.base, nullptr);
+            length = std::exchange(other.length, 0);
+            data = std::exchange(other.data, nullptr);
+            _capacity = std::exchange(other._capacity, 0);
+            _size = std::exchange(other._size, 0);
+        }
+        return *this;
+    }
+
+    std::optional<V> get(const K& key) const
+    {
+        if(_capacity == 0)
+        {
+            return std::nullopt;
+        }
+
+        size_t index = hash(key);
+        size_t start_index = index;
+        do
+        {
+            if(!data[index].occupied)
+            {
+                return std::nullopt;
+            }
+            if(data[index].key == key)
+            {
+                return data[index].value;
+            }
+            index = (index + 1) % _capacity;
+        } while(index != start_index);
+        return std::nullopt;
+    }
+
+    bool contains(const K& key) const
+    {
+        return get(key).has_value();
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+};
+
+} // namespace mla
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef __MLA_METRICS_H__
+#define __MLA_METRICS_H__
+
+#include "clock.h"
+#include "envelope.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+namespace detail::util
+{
+
+// Counter with a single writer. The writer updates it with a plain load and
+// store instead of a locked read-modify-write; other threads may read it at
+// any time.
+class SingleWriterCounter
+{
+public:
+    void add(std::uint64_t n)
+    {
+        value.store(value.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+    }
+
+    void max(std::uint64_t n)
+    {
+        if(n > value.load(std::memory_order_relaxed))
+            value.store(n, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t load() const
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> value{0};
+};
+
+} // namespace detail::util
+
+namespace mla::thread {
+
+// Queue instrumentation is compiled in only with MLA_EVENT_METRICS defined.
+// Without it, queues store plain events and record nothing.
+#ifdef MLA_EVENT_METRICS
+inline constexpr bool kEventMetrics = true;
+#else
+inline constexpr bool kEventMetrics = false;
+#endif
+
+static constexpr std::size_t kCacheLineSize = 64;
+
+// Log-linear histogram of nanosecond durations, in the style of
+// HdrHistogram: every power of two is split into 8 linear sub-buckets, so a
+// bucket is never wider than 1/8 of its values. Durations above 2^40 ns
+// (about 18 minutes) land in the last bucket.
+struct LatencyHistogram
+{
+    static constexpr unsigned kSubBucketBits = 3;
+    static constexpr unsigned kMaxBits = 40;
+    static constexpr std::size_t kBuckets =
+        std::size_t{kMaxBits - kSubBucketBits + 1} << kSubBucketBits;
+
+    static constexpr std::size_t bucketOf(std::uint64_t ns)
+    {
+        constexpr std::uint64_t kSubBuckets = 1u << kSubBucketBits;
+        if(ns < kSubBuckets)
+            return ns;
+
+        const unsigned msb = std::bit_width(ns) - 1;
+        const std::size_t bucket =
+            ((msb - kSubBucketBits + 1) << kSubBucketBits) +
+            ((ns >> (msb - kSubBucketBits)) & (kSubBuckets - 1));
+        return std::min(bucket, kBuckets - 1);
+    }
+
+    // Smallest duration that falls into bucket
+    static constexpr std::uint64_t lowerBound(std::size_t bucket)
+    {
+        constexpr std::size_t kSubBuckets = 1u << kSubBucketBits;
+        if(bucket < kSubBuckets)
+            return bucket;
+
+        const unsigned shift = bucket / kSubBuckets - 1;
+        return (kSubBuckets + bucket % kSubBuckets) << shift;
+    }
+
+    [[nodiscard]] std::uint64_t count() const
+    {
+        std::uint64_t total = 0;
+        for(auto n : counts)
+            total += n;
+        return total;
+    }
+
+    // Upper bound of the bucket holding the q-th quantile, q in [0, 1]
+    [[nodiscard]] std::uint64_t percentile(double q) const
+    {
+        const auto total = count();
+        if(total == 0)
+            return 0;
+
+        const auto rank = std::max<std::uint64_t>(
+            1, static_cast<std::uint64_t>(q * static_cast<double>(total)));
+        std::uint64_t seen = 0;
+        for(std::size_t i = 0; i < kBuckets; ++i)
+        {
+            seen += counts[i];
+            if(seen >= rank)
+                return i + 1 < kBuckets ? lowerBound(i + 1) - 1
+                                        : lowerBound(i);
+        }
+        return lowerBound(kBuckets - 1);
+    }
+
+    std::array<std::uint64_t, kBuckets> counts{};
+};
+
+struct HandlerStats
+{
+    std::uint64_t count = 0;
+    std::uint64_t totalNs = 0;
+    std::uint64_t maxNs = 0;
+};
+
+// Point-in-time copy of a queue's metrics. Counters are read one by one
+// while the consumer keeps running, so they may be a few events apart.
+struct QueueMetricsSnapshot
+{
+    std::uint64_t processed = 0;
+    std::size_t depth = 0;
+
+    // Time from push() until the event loop dequeued the event
+    LatencyHistogram wait;
+
+    // Handler duration by event index, e.g. the variant alternative
+    std::vector<HandlerStats> handlers;
+};
+
+// Number of event kinds a queue keeps handler statistics for
+template<typename EventType>
+inline constexpr std::size_t event_alternatives_v = 1;
+
+template<typename... Ts>
+inline constexpr std::size_t event_alternatives_v<std::variant<Ts...>> =
+    sizeof...(Ts);
+
+template<typename... Ts>
+inline constexpr std::size_t event_alternatives_v<Envelope<Ts...>> =
+    sizeof...(Ts);
+
+// Queue element carrying the time the event was pushed
+template<typename EventType>
+struct StampedEvent
+{
+    EventType event;
+    std::uint64_t enqueuedNs = 0;
+};
+
+// Metrics of one event queue. Everything is written by the consumer thread
+// only, and the block starts on a cache line of its own so that producers
+// touching the queue do not share lines with it.
+template<typename EventType>
+class alignas(kCacheLineSize) QueueMetrics
+{
+    static constexpr std::size_t kAlternatives =
+        event_alternatives_v<EventType>;
+
+    struct Handler
+    {
+        detail::util::SingleWriterCounter count;
+        detail::util::SingleWriterCounter totalNs;
+        detail::util::SingleWriterCounter maxNs;
+    };
+
+public:
+    static std::uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   clock::FastClock::now().time_since_epoch())
+            .count();
+    }
+
+    // Nanoseconds from start to end, 0 if end is earlier
+    static std::uint64_t elapsed(std::uint64_t start, std::uint64_t end)
+    {
+        const auto ns = static_cast<std::int64_t>(end - start);
+        return ns > 0 ? static_cast<std::uint64_t>(ns) : 0;
+    }
+
+    static std::size_t indexOf(const EventType& event)
+    {
+        if constexpr(requires { event.index(); })
+            return event.index();
+        else
+            return 0;
+    }
+
+    void recordWait(std::uint64_t ns)
+    {
+        _processed.add(1);
+        _wait[LatencyHistogram::bucketOf(ns)].add(1);
+    }
+
+    void recordHandler(std::size_t index, std::uint64_t ns)
+    {
+        // Empty envelopes, e.g. the one that stops the loop, have no index
+        [[unlikely]] if(index >= kAlternatives)
+            return;
+
+        auto& handler = _handlers[index];
+        handler.count.add(1);
+        handler.totalNs.add(ns);
+        handler.maxNs.max(ns);
+    }
+
+    [[nodiscard]] QueueMetricsSnapshot snapshot(std::size_t depth) const
+    {
+        QueueMetricsSnapshot result;
+        result.processed = _processed.load();
+        result.depth = depth;
+        for(std::size_t i = 0; i < LatencyHistogram::kBuckets; ++i)
+            result.wait.counts[i] = _wait[i].load();
+
+        result.handlers.reserve(kAlternatives);
+        for(const auto& handler : _handlers)
+            result.handlers.push_back({handler.count.load(),
+                                       handler.totalNs.load(),
+                                       handler.maxNs.load()});
+        return result;
+    }
+
+private:
+    detail::util::SingleWriterCounter _processed;
+    std::array<detail::util::SingleWriterCounter, LatencyHistogram::kBuckets>
+        _wait;
+    std::array<Handler, kAlternatives> _handlers;
+};
+
+struct NoQueueMetrics
+{
+};
+
+} // namespace mla::thread
+
+#endif // __MLA_METRICS_H__
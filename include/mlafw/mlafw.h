@@ -1,12 +1,30 @@
 #ifndef __MLA_H__
 #define __MLA_H__
 
+#include "actor.h"
+#include "attributedelta.h"
+#include "attributetable.h"
 #include "attributetuple.h"
+#include "attributewire.h"
+#include "clock.h"
 #include "common.h"
 #include "log.h"
 #include "signal.h"
 #include "thread.h"
+#include "envelope.h"
 #include "eventthread.h"
+#include "metrics.h"
+#include "objectpool.h"
+#include "request.h"
+#include "task.h"
+#include "shardedtimer.h"
 #include "timer.h"
 
+#ifdef __linux__
+#include "ipc.h"
+#include "reactor.h"
+#include "timerfd.h"
+#include "uring.h"
+#endif
+
 #endif
@@ -0,0 +1,165 @@
+#ifndef __MLA_OBJECTPOOL_H__
+#define __MLA_OBJECTPOOL_H__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace mla
+{
+
+template <typename T>
+class ObjectPool;
+
+// Owning handle to an object borrowed from an ObjectPool. Destroying the
+// handle gives the object back to its pool instead of deleting it, so
+// members such as std::string or std::vector keep their capacity and the
+// next user of the object does not allocate again.
+template <typename T>
+class Pooled
+{
+public:
+    Pooled() = default;
+
+    Pooled(Pooled&& other) noexcept
+        : node(std::exchange(other.node, nullptr)),
+          pool(std::exchange(other.pool, nullptr))
+    {
+    }
+
+    Pooled& operator=(Pooled&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            node = std::exchange(other.node, nullptr);
+            pool = std::exchange(other.pool, nullptr);
+        }
+        return *this;
+    }
+
+    Pooled(const Pooled&) = delete;
+    Pooled& operator=(const Pooled&) = delete;
+
+    ~Pooled()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if(node)
+        {
+            pool->release(std::exchange(node, nullptr));
+            pool = nullptr;
+        }
+    }
+
+    explicit operator bool() const
+    {
+        return node != nullptr;
+    }
+
+    T& operator*() const
+    {
+        return node->value;
+    }
+
+    T* operator->() const
+    {
+        return &node->value;
+    }
+
+    T* get() const
+    {
+        return node ? &node->value : nullptr;
+    }
+
+private:
+    friend class ObjectPool<T>;
+
+    using Node = typename ObjectPool<T>::Node;
+
+    Pooled(Node* node, ObjectPool<T>* pool) : node(node), pool(pool) {}
+
+    Node* node = nullptr;
+    ObjectPool<T>* pool = nullptr;
+};
+
+// Pool of reusable objects owned by one producer thread. acquire() must only
+// be called by the owner, but handles may be released from any thread: they
+// are pushed onto a lock-free return list that the owner takes over in one
+// exchange when its local free list runs dry. Objects are not reset between
+// uses. The pool must outlive every handle it has given out.
+template <typename T>
+class ObjectPool
+{
+public:
+    explicit ObjectPool(std::size_t initial_size = 0)
+    {
+        for(std::size_t i = 0; i < initial_size; ++i)
+        {
+            auto* node = allocate();
+            node->next = free;
+            free = node;
+        }
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    [[nodiscard]] Pooled<T> acquire()
+    {
+        [[unlikely]] if(!free)
+        {
+            free = returned.exchange(nullptr, std::memory_order_acquire);
+            if(!free)
+                return Pooled<T>(allocate(), this);
+        }
+
+        Node* node = free;
+        free = node->next;
+        return Pooled<T>(node, this);
+    }
+
+    // Number of objects created by this pool so far
+    std::size_t capacity() const
+    {
+        return nodes.size();
+    }
+
+private:
+    friend class Pooled<T>;
+
+    struct Node
+    {
+        T value{};
+        Node* next = nullptr;
+    };
+
+    Node* allocate()
+    {
+        nodes.push_back(std::make_unique<Node>());
+        return nodes.back().get();
+    }
+
+    void release(Node* node)
+    {
+        node->next = returned.load(std::memory_order_relaxed);
+        while(!returned.compare_exchange_weak(node->next, node,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    Node* free = nullptr;
+    std::atomic<Node*> returned{nullptr};
+};
+
+} // namespace mla
+
+#endif // __MLA_OBJECTPOOL_H__
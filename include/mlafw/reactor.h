@@ -0,0 +1,209 @@
+#ifndef __MLA_REACTOR_H__
+#define __MLA_REACTOR_H__
+
+#include "eventthread.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace mla::thread {
+
+// Readiness of a descriptor added to a ReactorThread; events are EPOLL*
+// flags
+struct IoReady
+{
+    int fd;
+    std::uint32_t events;
+};
+
+// EventThread that waits in epoll_wait() on its descriptors instead of on
+// the queue, and calls owner->onEvent(const IoReady&) on the same thread
+// as the queued events. push() writes an eventfd only when the loop is
+// parked, so a busy loop takes events from the queue without syscalls.
+// An FdTimer can be driven from here: add its backend().fd() and call
+// poll() on the timer when it becomes ready.
+template<typename Owner, typename EventType>
+class ReactorThread : public EventThread<Owner, EventType>
+{
+    using queue_item = typename BlockingEventQueue<EventType>::queue_item;
+
+public:
+    // Descriptors reported per epoll_wait(), and events taken from the
+    // queue before polling the descriptors again
+    static constexpr int kMaxEvents = 64;
+    static constexpr std::size_t kBatchSize = 64;
+
+    ReactorThread()
+    {
+        _eventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if(_eventFd < 0 || _epollFd < 0)
+            fail("Cannot create reactor descriptors");
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = _eventFd;
+        if(::epoll_ctl(_epollFd, EPOLL_CTL_ADD, _eventFd, &event) < 0)
+            fail("Cannot add eventfd to epoll");
+
+        this->_wakeOnPush = true;
+    }
+
+    ~ReactorThread() override
+    {
+        close();
+    }
+
+    // Watch fd for events. May be called from any thread; the descriptor
+    // stays owned by the caller.
+    void add(int fd, std::uint32_t events = EPOLLIN)
+    {
+        control(EPOLL_CTL_ADD, fd, events);
+    }
+
+    void modify(int fd, std::uint32_t events)
+    {
+        control(EPOLL_CTL_MOD, fd, events);
+    }
+
+    // Stop watching fd. Called from this thread, e.g. from its onEvent(),
+    // no readiness of fd is reported afterwards, so it can be closed right
+    // away. Other threads may still see one more IoReady for it.
+    void remove(int fd)
+    {
+        if(::epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr) < 0)
+            throw std::runtime_error(std::string("Cannot remove descriptor: ")
+                                     + std::strerror(errno));
+
+        if(_current != this)
+            return;
+        for(int i = _next; i < _count; ++i)
+        {
+            if(_events[i].data.fd == fd)
+                _events[i].data.fd = -1;
+        }
+    }
+
+    void execute() override
+    {
+        this->_isRunning.store(true);
+        _current = this;
+
+        while(true)
+        {
+            std::size_t handled = 0;
+            queue_item item;
+            while(handled < kBatchSize && this->tryDequeue(item))
+            {
+                this->dispatch(item);
+                ++handled;
+
+                [[unlikely]] if(!this->_isRunning.load())
+                    return;
+            }
+
+            // A full batch may have left events behind, so only look at
+            // the descriptors then
+            poll(handled == kBatchSize ? 0 : park());
+        }
+    }
+
+protected:
+    void unpark() override
+    {
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(_eventFd, &one, sizeof(one));
+    }
+
+private:
+    // Returns the epoll_wait() timeout: none if events came in meanwhile
+    int park()
+    {
+        this->_parked.store(true, std::memory_order_relaxed);
+        // Pairs with the fence in wakeIfParked(): either push() sees
+        // _parked, or its event is seen here
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(this->sizeApprox() == 0)
+            return -1;
+
+        this->_parked.store(false, std::memory_order_relaxed);
+        return 0;
+    }
+
+    void poll(int timeout)
+    {
+        int count;
+        while((count = ::epoll_wait(_epollFd, _events, kMaxEvents,
+                                    timeout)) < 0 &&
+              errno == EINTR)
+        {
+        }
+        this->_parked.store(false, std::memory_order_relaxed);
+
+        auto* owner = static_cast<Owner*>(this);
+        _count = count;
+        for(_next = 0; _next < _count;)
+        {
+            const auto& event = _events[_next++];
+            if(event.data.fd == _eventFd)
+            {
+                std::uint64_t value;
+                [[maybe_unused]] auto drained =
+                    ::read(_eventFd, &value, sizeof(value));
+            }
+            else if(event.data.fd >= 0)
+            {
+                owner->onEvent(IoReady{event.data.fd, event.events});
+            }
+        }
+        _count = 0;
+    }
+
+    void control(int op, int fd, std::uint32_t events)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if(::epoll_ctl(_epollFd, op, fd, &event) < 0)
+            throw std::runtime_error(std::string("Cannot watch descriptor: ")
+                                     + std::strerror(errno));
+    }
+
+    [[noreturn]] void fail(const std::string& what)
+    {
+        auto message = what + ": " + std::strerror(errno);
+        close();
+        throw std::runtime_error(message);
+    }
+
+    void close()
+    {
+        for(int fd : {_epollFd, _eventFd})
+        {
+            if(fd >= 0)
+                ::close(fd);
+        }
+        _epollFd = _eventFd = -1;
+    }
+
+    int _eventFd = -1;
+    int _epollFd = -1;
+
+    // Batch being dispatched, for remove()
+    static inline thread_local const ReactorThread* _current = nullptr;
+    epoll_event _events[kMaxEvents];
+    int _next = 0;
+    int _count = 0;
+};
+
+} // namespace mla::thread
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef __MLA_REQUEST_H__
+#define __MLA_REQUEST_H__
+
+#include "envelope.h"
+#include "objectpool.h"
+
+#include <utility>
+
+namespace mla::thread {
+
+template<typename EventType>
+class BlockingEventQueue;
+
+template<typename T>
+class Request;
+
+// Answer to a Request<T>. Holds the same pooled message the request was
+// sent with, so the reply reuses the requester's buffer. Dropping the reply
+// gives the message back to the requester's pool.
+template<typename T>
+class Reply
+{
+public:
+    Reply() = default;
+
+    T& operator*() const
+    {
+        return *message;
+    }
+
+    T* operator->() const
+    {
+        return message.get();
+    }
+
+    explicit operator bool() const
+    {
+        return static_cast<bool>(message);
+    }
+
+    // Take the message back, e.g. to send it in the next request
+    [[nodiscard]] Pooled<T> release() &&
+    {
+        return std::move(message);
+    }
+
+private:
+    friend class Request<T>;
+
+    explicit Reply(Pooled<T>&& message) : message(std::move(message)) {}
+
+    Pooled<T> message;
+};
+
+// Message sent to another EventThread that expects an answer. Only a pool
+// handle and the reply route travel through the queues, never the payload.
+// The handler owns the request and answers with std::move(request).reply(),
+// which sends the same message back to the requester as a Reply<T>. A
+// request dropped without a reply returns its message to the pool; custom
+// reply routes are called with an empty Reply<T> then, so nobody waits for
+// an answer that never comes.
+template<typename T>
+class Request
+{
+public:
+    Request() = default;
+
+    // replyTo must accept Reply<T> in its event type
+    template<typename EventType>
+    Request(Pooled<T>&& message, BlockingEventQueue<EventType>& replyTo)
+        : message(std::move(message)), target(&replyTo),
+          deliver([](void* target, Reply<T>&& reply)
+                  {
+                      if(reply)
+                          static_cast<BlockingEventQueue<EventType>*>(target)
+                              ->push(EventType{std::move(reply)});
+                  })
+    {
+    }
+
+    // Custom reply route: deliver(target, reply) is called by reply()
+    Request(Pooled<T>&& message, void* target,
+            void (*deliver)(void*, Reply<T>&&))
+        : message(std::move(message)), target(target), deliver(deliver)
+    {
+    }
+
+    Request(Request&& other) noexcept
+        : message(std::move(other.message)),
+          target(std::exchange(other.target, nullptr)),
+          deliver(std::exchange(other.deliver, nullptr))
+    {
+    }
+
+    ~Request()
+    {
+        drop();
+    }
+
+    Request& operator=(Request&& other) noexcept
+    {
+        drop();
+        message = std::move(other.message);
+        target = std::exchange(other.target, nullptr);
+        deliver = std::exchange(other.deliver, nullptr);
+        return *this;
+    }
+
+    T& operator*() const
+    {
+        return *message;
+    }
+
+    T* operator->() const
+    {
+        return message.get();
+    }
+
+    explicit operator bool() const
+    {
+        return static_cast<bool>(message);
+    }
+
+    void reply() &&
+    {
+        [[likely]] if(deliver)
+            deliver(std::exchange(target, nullptr),
+                    Reply<T>(std::move(message)));
+        deliver = nullptr;
+    }
+
+private:
+    // The message is back in the pool before the requester hears of it
+    void drop() noexcept
+    {
+        message.reset();
+        [[unlikely]] if(deliver)
+            std::exchange(deliver, nullptr)(std::exchange(target, nullptr),
+                                            Reply<T>());
+    }
+
+    Pooled<T> message;
+    void* target = nullptr;
+    void (*deliver)(void*, Reply<T>&&) = nullptr;
+};
+
+// Request and reply handles are pointer sized and own no memory of their
+// own, so envelopes carry them inline
+template<typename T>
+inline constexpr bool enable_inline_payload_v<Request<T>> = true;
+
+template<typename T>
+inline constexpr bool enable_inline_payload_v<Reply<T>> = true;
+
+} // namespace mla::thread
+
+#endif // __MLA_REQUEST_H__
@@ -0,0 +1,146 @@
+#ifndef __MLA_SHARDEDTIMER_H__
+#define __MLA_SHARDEDTIMER_H__
+
+#include "mlafw/timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace mla::timer {
+
+static constexpr std::size_t kMaxTimerShards = 256;
+
+// Timer service split into independent shards, each a BasicTimer with a
+// thread of its own. Timers are ordered on the calling thread's shard, so
+// threads on different shards never contend on a lock, and expired timers
+// of different shards fire in parallel. Each thread gets a shard round
+// robin on first use; EventThreads can pin themselves to one with
+// bindCurrentThread(). Ids carry their shard, so rearm() and cancel() work
+// from any thread.
+template<typename Backend>
+class BasicShardedTimer
+{
+public:
+    explicit BasicShardedTimer(std::size_t shards = defaultShards())
+    {
+        [[unlikely]] if(shards == 0 || shards > kMaxTimerShards)
+            throw std::runtime_error("Invalid number of timer shards");
+
+        _shards.reserve(shards);
+        for(std::size_t i = 0; i < shards; ++i)
+            _shards.push_back(std::make_unique<BasicTimer<Backend>>(
+                static_cast<std::uint8_t>(i)));
+    }
+
+    ~BasicShardedTimer()
+    {
+        exit();
+        join();
+    }
+
+    BasicShardedTimer(const BasicShardedTimer&) = delete;
+    BasicShardedTimer& operator=(const BasicShardedTimer&) = delete;
+
+    void start()
+    {
+        for(auto& shard : _shards)
+            shard->start();
+    }
+
+    void exit()
+    {
+        for(auto& shard : _shards)
+            shard->exit();
+    }
+
+    void join()
+    {
+        for(auto& shard : _shards)
+            shard->join();
+    }
+
+    [[nodiscard]] std::size_t shardCount() const
+    {
+        return _shards.size();
+    }
+
+    // Order timers of the calling thread on shard from now on
+    static void bindCurrentThread(std::size_t shard)
+    {
+        currentShard() = shard;
+    }
+
+    timer_id order(Callback cb, duration timeout,
+                   duration slack = duration::zero())
+    {
+        return local().order(std::move(cb), timeout, slack);
+    }
+
+    timer_id orderPeriodic(Callback cb, duration period,
+                           Periodic mode = Periodic::FixedRate,
+                           duration slack = duration::zero())
+    {
+        return local().orderPeriodic(std::move(cb), period, mode, slack);
+    }
+
+    bool rearm(timer_id id, duration timeout)
+    {
+        auto* shard = owner(id);
+        return shard && shard->rearm(id, timeout);
+    }
+
+    bool cancel(timer_id id)
+    {
+        auto* shard = owner(id);
+        return shard && shard->cancel(id);
+    }
+
+    BasicTimer<Backend>& shard(std::size_t index)
+    {
+        return *_shards.at(index);
+    }
+
+private:
+    static constexpr std::size_t kUnbound = ~std::size_t{0};
+
+    static std::size_t defaultShards()
+    {
+        return std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1,
+                                       kMaxTimerShards);
+    }
+
+    static std::size_t& currentShard()
+    {
+        static thread_local std::size_t shard = kUnbound;
+        return shard;
+    }
+
+    BasicTimer<Backend>& local()
+    {
+        auto& index = currentShard();
+        [[unlikely]] if(index == kUnbound)
+            index = _next.fetch_add(1, std::memory_order_relaxed);
+        return *_shards[index % _shards.size()];
+    }
+
+    BasicTimer<Backend>* owner(timer_id id)
+    {
+        auto index = BasicTimer<Backend>::shardOf(id);
+        return index < _shards.size() ? _shards[index].get() : nullptr;
+    }
+
+    std::vector<std::unique_ptr<BasicTimer<Backend>>> _shards;
+    std::atomic<std::size_t> _next{0};
+};
+
+using ShardedTimer = BasicShardedTimer<CondVarBackend>;
+
+} // namespace mla::timer
+
+#endif // __MLA_SHARDEDTIMER_H__
@@ -1,10 +1,289 @@
 #ifndef __MLA_SIGNAL_H__
 #define __MLA_SIGNAL_H__
 
+#include "envelope.h"
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace mla::thread {
+
+template<typename EventType>
+class BlockingEventQueue;
+
+} // namespace mla::thread
+
 namespace mla::signal {
 
+// Payload as seen by queued subscribers. Every subscriber of one emit gets
+// a handle to the same immutable object.
+template<typename T>
+using Shared = std::shared_ptr<const T>;
+
+class Connection
+{
+public:
+    Connection() = default;
+
+    explicit operator bool() const
+    {
+        return _id != 0;
+    }
+
+    bool operator==(const Connection&) const = default;
+
+private:
+    template<typename T>
+    friend class Signal;
+
+    explicit Connection(std::uint64_t id) : _id(id) {}
+
+    std::uint64_t _id = 0;
+};
+
+// Typed signal with direct and queued subscribers.
+//
+// Subscribers are kept in an immutable list that is replaced as a whole on
+// connect and disconnect (RCU style), so emit() never takes a lock and never
+// waits for a writer. Old lists are freed once every emit that started
+// before they were replaced has finished; a slot may therefore still be
+// called by an emit that started before its disconnect() returned.
+//
+// Direct slots run on the emitting thread. Queued slots push the payload to
+// an EventThread as a Shared<T>, which the thread's event type must accept.
+// The payload is copied to the heap at most once per emit, no matter how
+// many queued subscribers there are.
+template<typename T>
+class Signal
+{
+    struct Slot
+    {
+        std::uint64_t id;
+        std::function<void(const T&)> direct;
+        std::function<void(const Shared<T>&)> queued;
+    };
+
+    struct SlotList
+    {
+        std::vector<Slot> slots;
+        bool hasQueued = false;
+    };
+
+public:
+    Signal() = default;
+
+    Signal(const Signal&) = delete;
+    Signal& operator=(const Signal&) = delete;
+
+    // Must not run concurrently with emit()
+    ~Signal()
+    {
+        delete _slots.load();
+        for(auto* list : _retired)
+            delete list;
+        for(auto* list : _draining)
+            delete list;
+    }
+
+    // Call fn(const T&) on the emitting thread
+    template<typename Fn>
+        requires std::invocable<Fn&, const T&>
+    Connection connect(Fn&& fn)
+    {
+        return add(Slot{0, std::forward<Fn>(fn), {}});
+    }
+
+    // Push every payload to target as an event holding a Shared<T>
+    template<typename EventType>
+    Connection connect(mla::thread::BlockingEventQueue<EventType>& target)
+    {
+        return add(Slot{0,
+                        {},
+                        [&target](const Shared<T>& payload)
+                        { target.push(EventType{payload}); }});
+    }
+
+    bool disconnect(Connection connection)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const SlotList* current = _slots.load();
+        if(!current)
+            return false;
+
+        auto* list = new SlotList;
+        for(const auto& slot : current->slots)
+        {
+            if(slot.id == connection._id)
+                continue;
+            list->slots.push_back(slot);
+            list->hasQueued = list->hasQueued || slot.queued;
+        }
+
+        if(list->slots.size() == current->slots.size())
+        {
+            delete list;
+            return false;
+        }
+
+        publish(list);
+        return true;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const SlotList* current = _slots.load();
+        return current ? current->slots.size() : 0;
+    }
+
+    void emit(const T& value) const
+    {
+        std::size_t phase;
+        const SlotList* list = enter(phase);
+        [[likely]] if(list)
+        {
+            Shared<T> shared;
+            if(list->hasQueued)
+                shared = std::make_shared<const T>(value);
+            dispatch(*list, value, shared);
+        }
+        leave(phase);
+    }
+
+    // Emit a payload that is already shared, without copying it
+    void emit(const Shared<T>& payload) const
+    {
+        [[unlikely]] if(!payload)
+            throw std::runtime_error("Cannot emit an empty payload");
+
+        std::size_t phase;
+        const SlotList* list = enter(phase);
+        [[likely]] if(list)
+            dispatch(*list, *payload, payload);
+        leave(phase);
+    }
+
+private:
+    static void dispatch(const SlotList& list, const T& value,
+                         const Shared<T>& shared)
+    {
+        for(const auto& slot : list.slots)
+        {
+            if(slot.direct)
+                slot.direct(value);
+            else
+                slot.queued(shared);
+        }
+    }
+
+    Connection add(Slot&& slot)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        slot.id = ++_lastId;
+        const SlotList* current = _slots.load();
+
+        auto* list = current ? new SlotList(*current) : new SlotList;
+        list->hasQueued = list->hasQueued || slot.queued;
+        list->slots.push_back(std::move(slot));
+
+        publish(list);
+        return Connection(_lastId);
+    }
+
+    // Readers announce themselves in the counter of the current phase
+    // before loading the list. Replaced lists wait in _retired until the
+    // phase flips, then in _draining until the readers of the previous
+    // phase, the only ones that can still hold them, have all left. New
+    // readers count in the other phase meanwhile, so emits overlapping
+    // without end still let every list go. A reader whose phase flipped
+    // before it was counted could be missed by the next check of that
+    // phase, so it counts itself again in the new one.
+    const SlotList* enter(std::size_t& phase) const
+    {
+        for(;;)
+        {
+            phase = _phase.load();
+            _readers[phase].fetch_add(1);
+            [[likely]] if(_phase.load() == phase)
+                return _slots.load();
+            leave(phase);
+        }
+    }
+
+    void leave(std::size_t phase) const
+    {
+        [[unlikely]] if(_readers[phase].fetch_sub(1) == 1 &&
+                        _hasRetired.load())
+        {
+            std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+            if(lock)
+                reclaim();
+        }
+    }
+
+    // Called with _mutex held
+    void publish(const SlotList* list)
+    {
+        if(const SlotList* old = _slots.exchange(list))
+        {
+            _retired.push_back(old);
+            _hasRetired.store(true);
+            reclaim();
+        }
+    }
+
+    // Called with _mutex held
+    void reclaim() const
+    {
+        const std::size_t phase = _phase.load();
+        if(!_draining.empty())
+        {
+            if(_readers[phase ^ 1].load() != 0)
+                return;
+            for(auto* list : _draining)
+                delete list;
+            _draining.clear();
+        }
+
+        if(!_retired.empty())
+        {
+            _draining.swap(_retired);
+            _phase.store(phase ^ 1);
+        }
+        _hasRetired.store(!_draining.empty());
+    }
+
+    std::atomic<const SlotList*> _slots{nullptr};
+    mutable std::atomic<std::size_t> _phase{0};
+    mutable std::array<std::atomic<std::size_t>, 2> _readers{};
+
+    mutable std::mutex _mutex;
+    mutable std::vector<const SlotList*> _retired;
+    mutable std::vector<const SlotList*> _draining;
+    mutable std::atomic_bool _hasRetired{false};
+    std::uint64_t _lastId = 0;
+};
+
+} // namespace mla::signal
+
+namespace mla::thread {
 
+// Shared payloads move without allocating and are never copied, so
+// envelopes carry them inline
+template<typename T>
+inline constexpr bool enable_inline_payload_v<std::shared_ptr<const T>> =
+    true;
 
-}
+} // namespace mla::thread
 
 #endif
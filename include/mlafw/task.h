@@ -0,0 +1,444 @@
+#ifndef __MLA_TASK_H__
+#define __MLA_TASK_H__
+
+#include "objectpool.h"
+#include "request.h"
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace detail::util
+{
+
+// Per-thread free lists for coroutine frames, in 64 byte size classes up to
+// 4 KiB. A suspended and resumed coroutine keeps its frame, so this mostly
+// matters for short-lived tasks created on every event.
+class FrameAllocator
+{
+    static constexpr std::size_t kGranularity = 64;
+    static constexpr std::size_t kClasses = 64;
+
+    struct Block
+    {
+        Block* next;
+    };
+
+    struct FreeLists
+    {
+        std::array<Block*, kClasses> heads{};
+
+        ~FreeLists()
+        {
+            for(auto* head : heads)
+            {
+                while(head)
+                {
+                    std::free(std::exchange(head, head->next));
+                }
+            }
+        }
+    };
+
+    static FreeLists& lists()
+    {
+        static thread_local FreeLists instance;
+        return instance;
+    }
+
+    static constexpr std::size_t sizeClass(std::size_t size)
+    {
+        return (size + kGranularity - 1) / kGranularity - 1;
+    }
+
+public:
+    static void* allocate(std::size_t size)
+    {
+        const auto index = sizeClass(size);
+        [[likely]] if(index < kClasses)
+        {
+            auto& head = lists().heads[index];
+            if(head)
+                return std::exchange(head, head->next);
+            size = (index + 1) * kGranularity;
+        }
+
+        if(void* ptr = std::malloc(size))
+            return ptr;
+        throw std::bad_alloc();
+    }
+
+    // Frames may be freed on another thread than the one that allocated
+    // them; the block simply moves to the freeing thread's list
+    static void deallocate(void* ptr, std::size_t size) noexcept
+    {
+        const auto index = sizeClass(size);
+        [[likely]] if(index < kClasses)
+        {
+            auto& head = lists().heads[index];
+            head = ::new(ptr) Block{head};
+            return;
+        }
+        std::free(ptr);
+    }
+};
+
+} // namespace detail::util
+
+namespace mla::thread {
+
+// Event that resumes a suspended coroutine on the thread that dispatches it.
+// EventThreads running tasks need it among their event types.
+struct Resume
+{
+    std::coroutine_handle<> handle;
+};
+
+// Where a task continues after it has been woken up from another thread
+struct Scheduler
+{
+    void* target = nullptr;
+    void (*post)(void*, std::coroutine_handle<>) = nullptr;
+
+    // Resumes inline when the task is not bound to an event loop
+    void schedule(std::coroutine_handle<> handle) const
+    {
+        if(post)
+            post(target, handle);
+        else
+            handle.resume();
+    }
+};
+
+} // namespace mla::thread
+
+namespace detail::util
+{
+
+struct promise_base
+{
+    std::coroutine_handle<> continuation;
+    mla::thread::Scheduler scheduler;
+    std::exception_ptr exception;
+    bool detached = false;
+
+    static void* operator new(std::size_t size)
+    {
+        return FrameAllocator::allocate(size);
+    }
+
+    static void operator delete(void* ptr, std::size_t size) noexcept
+    {
+        FrameAllocator::deallocate(ptr, size);
+    }
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    struct final_awaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            auto& promise = handle.promise();
+            if(promise.continuation)
+                return promise.continuation;
+
+            if(promise.detached)
+            {
+                // Nobody is left to observe the exception
+                if(promise.exception)
+                    std::terminate();
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    final_awaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception()
+    {
+        exception = std::current_exception();
+    }
+};
+
+template<typename T>
+struct task_promise : promise_base
+{
+    std::optional<T> value;
+
+    template<typename U>
+    void return_value(U&& result)
+    {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T result()
+    {
+        if(exception)
+            std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct task_promise<void> : promise_base
+{
+    void return_void() {}
+
+    void result()
+    {
+        if(exception)
+            std::rethrow_exception(exception);
+    }
+};
+
+template<typename Promise>
+mla::thread::Scheduler schedulerOf(std::coroutine_handle<Promise> handle)
+{
+    if constexpr(std::is_base_of_v<promise_base, Promise>)
+        return handle.promise().scheduler;
+    else
+        return {};
+}
+
+} // namespace detail::util
+
+namespace mla {
+
+// Lazily started coroutine. Awaiting a task starts it and resumes the
+// awaiting coroutine when it finishes; the child inherits the scheduler of
+// its parent, so every awaiter in the chain resumes on the same EventThread.
+// Top-level tasks are started with EventThread::spawn().
+template<typename T = void>
+class [[nodiscard]] task
+{
+public:
+    struct promise_type;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    struct promise_type : detail::util::task_promise<T>
+    {
+        task get_return_object()
+        {
+            return task(handle_type::from_promise(*this));
+        }
+    };
+
+    task() = default;
+
+    task(task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+    task& operator=(task&& other) noexcept
+    {
+        if(this != &other)
+        {
+            if(handle)
+                handle.destroy();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task()
+    {
+        if(handle)
+            handle.destroy();
+    }
+
+    [[nodiscard]] bool done() const
+    {
+        return !handle || handle.done();
+    }
+
+    // Give up ownership of the coroutine, e.g. to run it detached
+    [[nodiscard]] handle_type release()
+    {
+        return std::exchange(handle, {});
+    }
+
+    auto operator co_await() && noexcept
+    {
+        return awaiter{handle};
+    }
+
+private:
+    struct awaiter
+    {
+        handle_type handle;
+
+        bool await_ready() noexcept
+        {
+            return !handle || handle.done();
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<Promise> caller) noexcept
+        {
+            handle.promise().continuation = caller;
+            handle.promise().scheduler = detail::util::schedulerOf(caller);
+            return handle;
+        }
+
+        T await_resume()
+        {
+            return handle.promise().result();
+        }
+    };
+
+    explicit task(handle_type handle) : handle(handle) {}
+
+    handle_type handle;
+};
+
+} // namespace mla
+
+namespace mla::thread {
+
+// co_await ask(target, message) sends message to target as a Request<T> and
+// resumes with the Reply<T> once target has answered. The Reply<T> is empty
+// if target dropped the request without answering. Must be awaited from a
+// task running on an EventThread.
+template<typename T, typename Target>
+class [[nodiscard]] ReplyAwaiter
+{
+public:
+    ReplyAwaiter(Target& target, Pooled<T>&& message)
+        : target(target), message(std::move(message))
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> caller)
+    {
+        handle = caller;
+        scheduler = detail::util::schedulerOf(caller);
+        target.push(typename Target::event_type{
+            Request<T>(std::move(message), this, &deliver)});
+    }
+
+    Reply<T> await_resume()
+    {
+        return std::move(reply);
+    }
+
+private:
+    static void deliver(void* self, Reply<T>&& reply)
+    {
+        auto* awaiter = static_cast<ReplyAwaiter*>(self);
+        awaiter->reply = std::move(reply);
+        awaiter->scheduler.schedule(awaiter->handle);
+    }
+
+    Target& target;
+    Pooled<T> message;
+    Reply<T> reply;
+    Scheduler scheduler;
+    std::coroutine_handle<> handle;
+};
+
+template<typename T, typename Target>
+ReplyAwaiter<T, Target> ask(Target& target, Pooled<T>&& message)
+{
+    return {target, std::move(message)};
+}
+
+// co_await offload(executor, fn) runs fn through executor.submit() and
+// resumes with its result on the awaiting task's EventThread
+template<typename Executor, typename Fn>
+class [[nodiscard]] JobAwaiter
+{
+    using result_type = std::invoke_result_t<Fn&>;
+    using storage_type =
+        std::conditional_t<std::is_void_v<result_type>, bool, result_type>;
+
+public:
+    JobAwaiter(Executor& executor, Fn fn)
+        : executor(executor), fn(std::move(fn))
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> caller)
+    {
+        handle = caller;
+        scheduler = detail::util::schedulerOf(caller);
+        executor.submit([this] { run(); });
+    }
+
+    result_type await_resume()
+    {
+        if(exception)
+            std::rethrow_exception(exception);
+        if constexpr(!std::is_void_v<result_type>)
+            return std::move(*result);
+    }
+
+private:
+    void run()
+    {
+        try
+        {
+            if constexpr(std::is_void_v<result_type>)
+                fn();
+            else
+                result.emplace(fn());
+        }
+        catch(...)
+        {
+            exception = std::current_exception();
+        }
+        scheduler.schedule(handle);
+    }
+
+    Executor& executor;
+    Fn fn;
+    std::optional<storage_type> result;
+    std::exception_ptr exception;
+    Scheduler scheduler;
+    std::coroutine_handle<> handle;
+};
+
+template<typename Executor, typename Fn>
+JobAwaiter<Executor, std::decay_t<Fn>> offload(Executor& executor, Fn&& fn)
+{
+    return {executor, std::forward<Fn>(fn)};
+}
+
+} // namespace mla::thread
+
+#endif // __MLA_TASK_H__
@@ -1,21 +1,42 @@
 #ifndef __MLA_TIMER_H__
 #define __MLA_TIMER_H__
 
-#include "mlafw/common.h"
+#include "mlafw/clock.h"
+#include "mlafw/task.h"
 #include "mlafw/thread.h"
 
+#include "concurrentqueue.h"
+
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <atomic>
+
+namespace mla::thread {
+
+template<typename EventType>
+class BlockingEventQueue;
+
+} // namespace mla::thread
 
 namespace mla::timer {
 
+// Deadlines are read from clock::FastClock, in steady_clock time. The timer
+// thread checks them against its backend's now(), the clock its waits are
+// measured on, so a FastClock lagging behind cannot make it spin.
 using clock_type = std::chrono::steady_clock;
-using duration = std::chrono::milliseconds;
-using timer_id = unsigned;
+using duration = std::chrono::nanoseconds;
+using timer_id = std::uint64_t;
 
 class Receiver
 {
@@ -30,124 +51,799 @@ using receiver_type = std::weak_ptr<Receiver>;
 using receiver_type = Receiver*;
 #endif
 
-class Timer : public thread::Thread
+// Callables of up to this size are stored in the timer without allocating
+static constexpr std::size_t kCallbackInlineSize = 48;
+
+// What a timer calls on expiry: a move-only void(timer_id) callable, or a
+// receiver_type whose timeout() is called. Callables that fit
+// kCallbackInlineSize and are nothrow movable are stored in place, so
+// captured context needs no lookup by id and no allocation; bigger ones
+// are moved to the heap.
+class Callback
 {
-    struct TimerEvent
+    struct Ops
     {
-        std::chrono::steady_clock::time_point expiry;
-        receiver_type receiver;
-        timer_id id;
+        void (*invoke)(void* storage, timer_id id);
+        void (*move)(void* to, void* from) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template<typename Fn>
+    static constexpr bool fits_inline_v =
+        sizeof(Fn) <= kCallbackInlineSize &&
+        alignof(Fn) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<Fn>;
+
+    // Inline callables live in the storage, others are owned through a
+    // pointer stored there
+    template<typename Fn>
+    static Fn& target(void* storage)
+    {
+        if constexpr(fits_inline_v<Fn>)
+            return *std::launder(static_cast<Fn*>(storage));
+        else
+            return **static_cast<Fn**>(storage);
+    }
+
+    template<typename Fn>
+    static constexpr Ops ops{
+        [](void* storage, timer_id id) { target<Fn>(storage)(id); },
+        [](void* to, void* from) noexcept
+        {
+            if constexpr(fits_inline_v<Fn>)
+            {
+                ::new(to) Fn(std::move(target<Fn>(from)));
+                std::destroy_at(&target<Fn>(from));
+            }
+            else
+            {
+                ::new(to) Fn*(*static_cast<Fn**>(from));
+            }
+        },
+        [](void* storage) noexcept
+        {
+            if constexpr(fits_inline_v<Fn>)
+                std::destroy_at(&target<Fn>(storage));
+            else
+                delete *static_cast<Fn**>(storage);
+        }};
+
+public:
+    Callback() = default;
+
+    template<typename Fn, typename F = std::decay_t<Fn>>
+        requires(!std::is_same_v<F, Callback> &&
+                 std::is_invocable_v<F&, timer_id>)
+    Callback(Fn&& fn) : _ops(&ops<F>)
+    {
+        if constexpr(fits_inline_v<F>)
+            ::new(static_cast<void*>(_storage)) F(std::forward<Fn>(fn));
+        else
+            ::new(static_cast<void*>(_storage))
+                F*(new F(std::forward<Fn>(fn)));
+    }
+
+    template<typename R>
+        requires(!std::is_invocable_v<R&, timer_id> &&
+                 std::is_convertible_v<R, receiver_type>)
+    Callback(R&& receiver)
+        : Callback(
+#ifdef USE_SMART_POINTER_RECEIVER
+              [receiver = receiver_type(std::forward<R>(receiver))](
+                  timer_id id)
+              {
+                  if(auto locked = receiver.lock())
+                      locked->timeout(id);
+              }
+#else
+              [receiver = receiver_type(receiver)](timer_id id)
+              { receiver->timeout(id); }
+#endif
+          )
+    {
+    }
+
+    Callback(Callback&& other) noexcept
+    {
+        moveFrom(other);
+    }
 
-        bool operator>(const TimerEvent& other) const
+    Callback& operator=(Callback&& other) noexcept
+    {
+        if(this != &other)
         {
-            return expiry > other.expiry;
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    Callback(const Callback&) = delete;
+    Callback& operator=(const Callback&) = delete;
+
+    ~Callback()
+    {
+        reset();
+    }
+
+    explicit operator bool() const
+    {
+        return _ops != nullptr;
+    }
+
+    void operator()(timer_id id)
+    {
+        _ops->invoke(_storage, id);
+    }
+
+    void reset()
+    {
+        if(_ops)
+            _ops->destroy(_storage);
+        _ops = nullptr;
+    }
+
+private:
+    void moveFrom(Callback& other)
+    {
+        if(other._ops)
+            other._ops->move(_storage, other._storage);
+        _ops = std::exchange(other._ops, nullptr);
+    }
+
+    alignas(std::max_align_t) std::byte _storage[kCallbackInlineSize];
+    const Ops* _ops = nullptr;
+};
+
+// Callback pushing a copy of event to queue, e.g. an EventThread, on every
+// expiry: timer::order(timer::pushTo(*this, Tick{}), 10ms)
+template<typename EventType, typename Event>
+Callback pushTo(thread::BlockingEventQueue<EventType>& queue, Event event)
+{
+    return [&queue, event = std::move(event)](timer_id)
+    { queue.push(EventType{event}); };
+}
+
+// Default wait strategy of BasicTimer: a condition variable. Portable, but
+// its wakeups are typically tens of microseconds late.
+class CondVarBackend
+{
+public:
+    // Clock that wait() measures the armed deadline on
+    static clock_type::time_point now()
+    {
+        return clock_type::now();
+    }
+
+    // Next deadline to wake up at; time_point::max() for none
+    void arm(clock_type::time_point deadline)
+    {
+        _deadline = deadline;
+    }
+
+    // Block until the armed deadline or notify(). A notify() that comes
+    // before wait() is kept, so the wakeup is not lost.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        auto notified = [this] { return _notified; };
+        if(_deadline == clock_type::time_point::max())
+            _cv.wait(lock, notified);
+        else
+            _cv.wait_until(lock, _deadline, notified);
+        _notified = false;
+    }
+
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _notified = true;
+        }
+        _cv.notify_one();
+    }
+
+    void drain()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _notified = false;
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _notified = false;
+    clock_type::time_point _deadline = clock_type::time_point::max();
+};
+
+// How a periodic timer computes its next deadline
+enum class Periodic
+{
+    // Fire every period measured from the previous deadline. Periods that
+    // were missed entirely are skipped, not fired in a burst.
+    FixedRate,
+    // Fire one period after the previous timeout() has returned
+    FixedDelay,
+};
+
+// Timer thread calling each timer's Callback at the requested deadlines.
+// Timers are ordered by their latest deadline, timeout + slack. Every
+// wakeup collects the timers whose latest deadline has passed, plus those
+// next in that order whose timeout has, and fires them in one batch, so a
+// timer cancelled while its batch is being fired may still fire once. A
+// timer ordered with slack may fire anywhere within [timeout, timeout +
+// slack], which lets nearby deadlines share a wakeup; an expired timer
+// queued behind one that is not waits for a later wakeup, at the latest
+// its own latest deadline. Backend decides how the thread sleeps until the
+// next deadline.
+//
+// The heap of pending timers belongs to the timer thread alone. order()
+// reserves a slot from a lock-free free list, fills it in and pushes an
+// arm command to a lock-free queue; rearm() and cancel() push commands as
+// well. The thread applies all commands before it computes its next
+// deadline, and a producer only wakes it up when its deadline is earlier
+// than the one the thread is sleeping until. Slots are kept in a binary
+// heap that tracks each timer's position, so periodic timers and rearm()
+// move a timer within the heap instead of ordering it again. Once the slot
+// table has grown to its peak size, nothing allocates.
+template<typename Backend>
+class BasicTimer : public thread::Thread
+{
+    static constexpr std::uint32_t kNotQueued = ~std::uint32_t{0};
+    static constexpr std::uint32_t kNoSlot = ~std::uint32_t{0};
+
+    // Ids hold the slot index in the low 24 bits, the timer's shard in the
+    // next 8 and the slot's generation in the high 32 bits, so ids of
+    // finished timers never match a reused slot
+    static constexpr unsigned kSlotBits = 24;
+    static constexpr unsigned kGenerationShift = 32;
+
+    // Slots are allocated in chunks that never move, so producers can
+    // fill in a slot while the timer thread uses others
+    static constexpr unsigned kChunkBits = 12;
+    static constexpr std::size_t kChunkSize = std::size_t{1} << kChunkBits;
+    static constexpr std::size_t kMaxChunks =
+        std::size_t{1} << (kSlotBits - kChunkBits);
+
+    // Deadline word while the timer thread is awake: it applies every
+    // command before sleeping, so producers need not wake it
+    static constexpr std::int64_t kAwake =
+        std::numeric_limits<std::int64_t>::min();
+
+    enum class Kind : std::uint8_t
+    {
+        OneShot,
+        FixedRate,
+        FixedDelay,
+    };
+
+    struct TimerSlot
+    {
+        // Written by the producer that reserved the slot, then only by the
+        // timer thread
+        clock_type::time_point expiry;
+        duration period{};
+        duration slack{};
+        Callback callback;
+        Kind kind = Kind::OneShot;
+
+        // Owned by the timer thread
+        std::uint32_t heapIndex = kNotQueued;
+        bool armed = false;
+        bool cancelled = false;
+        bool firing = false;
+
+        // Current id; bumped by the timer thread when the slot is freed
+        std::atomic<timer_id> id{0};
+        std::atomic<std::uint32_t> nextFree{kNoSlot};
+
+        clock_type::time_point latest() const
+        {
+            return expiry + slack;
         }
     };
 
+    struct Command
+    {
+        enum class Type : std::uint8_t
+        {
+            Arm,
+            Rearm,
+            Cancel,
+        };
+
+        Type type;
+        timer_id id;
+        clock_type::time_point expiry;
+    };
+
 public:
-    static Timer* instance()
+    static BasicTimer* instance()
     {
-        static Timer instance;
+        static BasicTimer instance;
         return &instance;
     }
 
-    ~Timer() = default;
+    // shard is stored in every id, see BasicShardedTimer
+    explicit BasicTimer(std::uint8_t shard = 0) : _shard(shard) {}
+
+    ~BasicTimer()
+    {
+        for(auto& chunk : _chunks)
+            delete[] chunk.load();
+    }
 
     void execute() override
     {
         [[likely]] while(_running)
         {
-            std::unique_lock<std::mutex> lock(_mutex);
+            if(!step() && _running)
+                _backend.wait();
+        }
+    }
 
-            if(_queue.empty())
-            {
-                _cv.wait(lock,
-                        [this] { return !_queue.empty() || !_running; });
-                [[unlikely]] if(!_running)
-                    break;
-            }
+    void exit() override
+    {
+        _running = false;
+        _backend.notify();
+    }
 
-            auto now = std::chrono::steady_clock::now();
-            if(_queue.top().expiry <= now)
-            {
-                auto event = _queue.top();
-                _queue.pop();
-                event.receiver->timeout(event.id);
-            }
-            else
+    // Fire everything that is due without blocking. For timers driven by
+    // another event loop instead of their own thread.
+    void poll()
+    {
+        _backend.drain();
+        while(step())
+        {
+        }
+    }
+
+    timer_id order(Callback cb, duration timeout,
+                   duration slack = duration::zero())
+    {
+        return add(std::move(cb), timeout, duration::zero(), slack,
+                   Kind::OneShot);
+    }
+
+    // Fire every period until cancelled, the first time one period from now
+    timer_id orderPeriodic(Callback cb, duration period,
+                           Periodic mode = Periodic::FixedRate,
+                           duration slack = duration::zero())
+    {
+        [[unlikely]] if(period <= duration::zero())
+            throw std::runtime_error("Timer period must be positive");
+
+        return add(std::move(cb), period, period, slack,
+                   mode == Periodic::FixedRate ? Kind::FixedRate
+                                               : Kind::FixedDelay);
+    }
+
+    // Move a pending timer to fire timeout from now. Works from within its
+    // own timeout(), which makes a one-shot timer fire once more. Periodic
+    // timers continue their period from the new deadline. Returns false if
+    // the timer has already finished or was cancelled.
+    bool rearm(timer_id id, duration timeout)
+    {
+        if(!pending(id))
+            return false;
+
+        auto expiry = clock::FastClock::now() + timeout;
+        _commands.enqueue({Command::Type::Rearm, id, expiry});
+        wake(expiry);
+        return true;
+    }
+
+    // Returns false if the timer has already finished or was cancelled
+    bool cancel(timer_id id)
+    {
+        if(!pending(id))
+            return false;
+
+        _commands.enqueue({Command::Type::Cancel, id, {}});
+        return true;
+    }
+
+    Backend& backend()
+    {
+        return _backend;
+    }
+
+    // Shard the timer was ordered on
+    static std::size_t shardOf(timer_id id)
+    {
+        return static_cast<std::uint8_t>(id >> kSlotBits);
+    }
+
+private:
+    BasicTimer(const BasicTimer&) = delete;
+    BasicTimer& operator=(const BasicTimer&) = delete;
+
+    static std::uint32_t index(timer_id id)
+    {
+        return static_cast<std::uint32_t>(id) & ((1u << kSlotBits) - 1);
+    }
+
+    static std::int64_t ticks(clock_type::time_point time)
+    {
+        return std::chrono::duration_cast<duration>(time.time_since_epoch())
+            .count();
+    }
+
+    TimerSlot& slot(std::uint32_t slotIndex) const
+    {
+        return _chunks[slotIndex >> kChunkBits].load(
+            std::memory_order_acquire)[slotIndex & (kChunkSize - 1)];
+    }
+
+    // Whether id is still the current id of its slot. It may have fired or
+    // been cancelled already if a command for it is still queued.
+    bool pending(timer_id id) const
+    {
+        auto slotIndex = index(id);
+        auto* chunk =
+            _chunks[slotIndex >> kChunkBits].load(std::memory_order_acquire);
+        return shardOf(id) == _shard && chunk &&
+               chunk[slotIndex & (kChunkSize - 1)].id.load(
+                   std::memory_order_acquire) == id;
+    }
+
+    timer_id add(Callback cb, duration timeout, duration period,
+                 duration slack, Kind kind)
+    {
+        auto& timer = slot(reserve());
+        timer.expiry = clock::FastClock::now() + timeout;
+        timer.period = period;
+        timer.slack = slack;
+        timer.callback = std::move(cb);
+        timer.kind = kind;
+
+        // The slot belongs to the timer thread once the command is queued
+        auto id = timer.id.load(std::memory_order_relaxed);
+        auto latest = timer.latest();
+        _commands.enqueue({Command::Type::Arm, id, {}});
+        wake(latest);
+        return id;
+    }
+
+    // Pop a slot from the free list, which is tagged against ABA, or take
+    // a new one from the end of the table
+    std::uint32_t reserve()
+    {
+        auto head = _freeHead.load(std::memory_order_acquire);
+        while(static_cast<std::uint32_t>(head) != kNoSlot)
+        {
+            auto slotIndex = static_cast<std::uint32_t>(head);
+            auto next = slot(slotIndex).nextFree.load(
+                std::memory_order_relaxed);
+            auto tag = (head >> 32) + 1;
+            if(_freeHead.compare_exchange_weak(head, tag << 32 | next,
+                                               std::memory_order_acquire))
+                return slotIndex;
+        }
+
+        auto slotIndex = _slotReserved.fetch_add(1);
+        [[unlikely]] if(slotIndex >= std::uint32_t{1} << kSlotBits)
+            throw std::runtime_error("Too many pending timers");
+
+        auto& chunk = _chunks[slotIndex >> kChunkBits];
+        if(!chunk.load(std::memory_order_acquire))
+        {
+            auto* slots = new TimerSlot[kChunkSize];
+            auto first = slotIndex & ~std::uint32_t(kChunkSize - 1);
+            for(std::uint32_t i = 0; i < kChunkSize; ++i)
+                slots[i].id = timer_id{1} << kGenerationShift |
+                              timer_id{_shard} << kSlotBits | (first + i);
+
+            TimerSlot* expected = nullptr;
+            if(!chunk.compare_exchange_strong(expected, slots))
+                delete[] slots;
+        }
+        return slotIndex;
+    }
+
+    // Called by the timer thread
+    void release(TimerSlot& timer)
+    {
+        auto slotIndex = index(timer.id.load(std::memory_order_relaxed));
+        timer.callback.reset();
+        timer.armed = timer.cancelled = timer.firing = false;
+        timer.id.fetch_add(timer_id{1} << kGenerationShift,
+                           std::memory_order_release);
+
+        auto head = _freeHead.load(std::memory_order_relaxed);
+        do
+        {
+            timer.nextFree.store(static_cast<std::uint32_t>(head),
+                                 std::memory_order_relaxed);
+        } while(!_freeHead.compare_exchange_weak(
+            head, ((head >> 32) + 1) << 32 | slotIndex,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // Wake up the timer thread if it sleeps past the new deadline
+    void wake(clock_type::time_point deadline)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        auto next = ticks(deadline);
+        auto current = _nextDeadline.load(std::memory_order_relaxed);
+        while(next < current)
+        {
+            if(_nextDeadline.compare_exchange_weak(current, next))
             {
-                _cv.wait_until(lock, _queue.top().expiry);
+                _backend.notify();
+                return;
             }
         }
     }
 
-    void exit() override
+    // One round of the timer thread: apply commands and fire what is due.
+    // Returns false once there is nothing to do before the next deadline,
+    // with the backend armed for it.
+    bool step()
     {
-        _running = false;
-        _cv.notify_all();
+        _nextDeadline.store(kAwake);
+
+        apply();
+        retire();
+        collect();
+
+        if(!_due.empty())
+        {
+            fire();
+            return true;
+        }
+
+        auto next = _heap.empty() ? clock_type::time_point::max()
+                                  : slot(_heap.front()).latest();
+        _nextDeadline.store(ticks(next));
+
+        // Pairs with the fence in wake(): either the producer sees the new
+        // deadline, or its command is seen here
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(_commands.size_approx() > 0)
+            return true;
+
+        _backend.arm(next);
+        return false;
     }
 
-    timer_id order(receiver_type cb, duration timeout)
+    void apply()
     {
-        auto now = std::chrono::steady_clock::now();
-        auto id = mla::Id::getId();
-
+        Command commands[64];
+        while(auto count = _commands.try_dequeue_bulk(commands, 64))
         {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _queue.push({.expiry = now + timeout, .receiver = cb, .id = id});
+            for(std::size_t i = 0; i < count; ++i)
+                apply(commands[i]);
         }
+    }
 
-        _cv.notify_one();
-        return id;
+    // A rearm or cancel handed over to another thread may overtake the arm
+    // command of its timer, so both work on slots that are not armed yet
+    void apply(const Command& command)
+    {
+        auto slotIndex = index(command.id);
+        auto& timer = slot(slotIndex);
+        if(timer.id.load(std::memory_order_relaxed) != command.id)
+            return;
+
+        switch(command.type)
+        {
+        case Command::Type::Arm:
+            if(timer.cancelled)
+            {
+                release(timer);
+                return;
+            }
+            timer.armed = true;
+            push(slotIndex);
+            break;
+
+        case Command::Type::Rearm:
+            if(timer.cancelled)
+                return;
+            timer.expiry = command.expiry;
+            if(!timer.armed)
+                return;
+            if(timer.heapIndex == kNotQueued)
+                push(slotIndex);
+            else
+                update(timer.heapIndex);
+            break;
+
+        case Command::Type::Cancel:
+            if(timer.cancelled)
+                return;
+            timer.cancelled = true;
+            if(!timer.armed)
+                return;
+            if(timer.heapIndex != kNotQueued)
+                remove(timer.heapIndex);
+            // A timer being fired is released once its batch is done
+            if(!timer.firing)
+                release(timer);
+            break;
+        }
     }
 
-    bool cancel(timer_id id)
+    // The top has the earliest latest deadline. Tops go in the batch while
+    // their timeout has passed, which takes every timer whose latest
+    // deadline has passed; an expired timer below the first top that has
+    // not expired stays queued until a later wakeup.
+    void collect()
     {
-        std::lock_guard<std::mutex> lock(_mutex);
-        bool found = false;
+        auto now = Backend::now();
+        while(!_heap.empty())
+        {
+            auto& timer = slot(_heap.front());
+            if(timer.expiry > now)
+                break;
 
-        // Create a temporary vector to hold all events
-        std::vector<TimerEvent> temp;
+            _due.push_back(timer.id.load(std::memory_order_relaxed));
+            if(timer.kind == Kind::FixedRate)
+            {
+                do
+                {
+                    timer.expiry += timer.period;
+                } while(timer.expiry <= now);
+                update(0);
+            }
+            else
+            {
+                remove(0);
+                timer.firing = true;
+            }
+        }
+    }
+
+    // Runs after the commands sent during the last batch have been
+    // applied. Releases the one-shot timers and queues fixed delay timers
+    // again, unless they were re-armed or cancelled meanwhile.
+    void retire()
+    {
+        if(_due.empty())
+            return;
 
-        // Move all events except the one to be cancelled to the temporary
-        // vector
-        while(!_queue.empty())
+        auto now = Backend::now();
+        for(auto id : _due)
         {
-            if(_queue.top().id == id)
+            auto& timer = slot(index(id));
+            if(timer.id.load(std::memory_order_relaxed) != id ||
+               !timer.firing)
+                continue;
+
+            timer.firing = false;
+            if(timer.heapIndex != kNotQueued)
+                continue;
+
+            if(!timer.cancelled && timer.kind == Kind::FixedDelay)
             {
-                found = true;
-                _queue.pop();
+                timer.expiry = now + timer.period;
+                push(index(id));
             }
             else
             {
-                temp.push_back(_queue.top());
-                _queue.pop();
+                release(timer);
             }
         }
+        _due.clear();
+    }
+
+    // Slots are only released by this thread, so callbacks are called in
+    // place; they may order, rearm or cancel timers meanwhile
+    void fire()
+    {
+        for(auto id : _due)
+            slot(index(id)).callback(id);
+    }
+
+    // Binary min-heap of slot indices ordered by latest deadline
+    bool before(std::uint32_t a, std::uint32_t b) const
+    {
+        return slot(_heap[a]).latest() < slot(_heap[b]).latest();
+    }
+
+    void swapNodes(std::uint32_t a, std::uint32_t b)
+    {
+        std::swap(_heap[a], _heap[b]);
+        slot(_heap[a]).heapIndex = a;
+        slot(_heap[b]).heapIndex = b;
+    }
+
+    void siftUp(std::uint32_t node)
+    {
+        while(node > 0)
+        {
+            auto parent = (node - 1) / 2;
+            if(!before(node, parent))
+                break;
+            swapNodes(node, parent);
+            node = parent;
+        }
+    }
 
-        // Push all events back into the priority queue
-        for(const auto& event : temp)
+    void siftDown(std::uint32_t node)
+    {
+        const auto size = static_cast<std::uint32_t>(_heap.size());
+        while(true)
         {
-            _queue.push(event);
+            auto smallest = node;
+            for(auto child : {2 * node + 1, 2 * node + 2})
+            {
+                if(child < size && before(child, smallest))
+                    smallest = child;
+            }
+            if(smallest == node)
+                break;
+            swapNodes(node, smallest);
+            node = smallest;
         }
+    }
 
-        return found;
+    void push(std::uint32_t slotIndex)
+    {
+        _heap.push_back(slotIndex);
+        slot(slotIndex).heapIndex =
+            static_cast<std::uint32_t>(_heap.size() - 1);
+        siftUp(slot(slotIndex).heapIndex);
     }
 
-private:
-    Timer() = default;
-    Timer(const Timer&) = delete;
-    Timer& operator=(const Timer&) = delete;
+    void remove(std::uint32_t node)
+    {
+        const auto last = static_cast<std::uint32_t>(_heap.size() - 1);
+        if(node != last)
+            swapNodes(node, last);
 
-    std::priority_queue<TimerEvent, std::vector<TimerEvent>, std::greater<>> _queue;
-    std::mutex _mutex;
-    std::condition_variable _cv;
+        slot(_heap.back()).heapIndex = kNotQueued;
+        _heap.pop_back();
+        if(node != last)
+            update(node);
+    }
+
+    void update(std::uint32_t node)
+    {
+        auto slotIndex = _heap[node];
+        siftUp(node);
+        siftDown(slot(slotIndex).heapIndex);
+    }
+
+    std::array<std::atomic<TimerSlot*>, kMaxChunks> _chunks{};
+    std::atomic<std::uint32_t> _slotReserved{0};
+    std::atomic<std::uint64_t> _freeHead{kNoSlot};
+
+    moodycamel::ConcurrentQueue<Command> _commands;
+    // Nothing armed yet, so the first order() wakes up the timer
+    std::atomic<std::int64_t> _nextDeadline{
+        std::numeric_limits<std::int64_t>::max()};
+
+    // Timer thread only
+    std::vector<std::uint32_t> _heap;
+    std::vector<timer_id> _due;
+
+    Backend _backend;
     std::atomic_bool _running{true};
+    const std::uint8_t _shard;
 };
 
-inline timer_id order(receiver_type cb, duration timeout)
+using Timer = BasicTimer<CondVarBackend>;
+
+inline timer_id order(Callback cb, duration timeout,
+                      duration slack = duration::zero())
+{
+    return Timer::instance()->order(std::move(cb), timeout, slack);
+}
+
+inline timer_id orderPeriodic(Callback cb, duration period,
+                              Periodic mode = Periodic::FixedRate,
+                              duration slack = duration::zero())
+{
+    return Timer::instance()->orderPeriodic(std::move(cb), period, mode,
+                                            slack);
+}
+
+inline bool rearm(timer_id id, duration timeout)
 {
-    return Timer::instance()->order(std::move(cb), timeout);
+    return Timer::instance()->rearm(id, timeout);
 }
 
 inline bool cancel(timer_id id)
@@ -155,6 +851,53 @@ inline bool cancel(timer_id id)
     return Timer::instance()->cancel(id);
 }
 
+// co_await sleep_for(timeout) suspends the awaiting task until a timer of
+// timer, e.g. a ShardedTimer or an FdTimer, expires and resumes it on the
+// task's EventThread
+template<typename TimerService>
+class [[nodiscard]] SleepAwaiter
+{
+public:
+    SleepAwaiter(TimerService& timer, duration timeout)
+        : _timer(timer), _timeout(timeout)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return _timeout <= duration::zero();
+    }
+
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> caller)
+    {
+        _handle = caller;
+        _scheduler = detail::util::schedulerOf(caller);
+        _timer.order([this](timer_id) { _scheduler.schedule(_handle); },
+                     _timeout);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    TimerService& _timer;
+    duration _timeout;
+    thread::Scheduler _scheduler;
+    std::coroutine_handle<> _handle;
+};
+
+template<typename TimerService>
+SleepAwaiter<TimerService> sleep_for(TimerService& timer, duration timeout)
+{
+    return SleepAwaiter<TimerService>(timer, timeout);
+}
+
+// Sleep on the global Timer
+inline SleepAwaiter<Timer> sleep_for(duration timeout)
+{
+    return sleep_for(*Timer::instance(), timeout);
+}
+
 } // namespace mla::timer
 
 #endif
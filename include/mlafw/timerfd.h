@@ -0,0 +1,147 @@
+#ifndef __MLA_TIMERFD_H__
+#define __MLA_TIMERFD_H__
+
+#include "mlafw/timer.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace mla::timer {
+
+// Linux wait strategy for BasicTimer: a CLOCK_MONOTONIC timerfd armed at
+// the next deadline with nanosecond resolution, and an eventfd for new
+// orders, both in one epoll set. fd() is that epoll descriptor, so a timer
+// can also be driven from another epoll loop: add fd() there for EPOLLIN
+// and call poll() on the timer whenever it becomes readable.
+class TimerFdBackend
+{
+public:
+    TimerFdBackend()
+    {
+        _timerFd = ::timerfd_create(CLOCK_MONOTONIC,
+                                    TFD_NONBLOCK | TFD_CLOEXEC);
+        _eventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if(_timerFd < 0 || _eventFd < 0 || _epollFd < 0)
+            fail("Cannot create timer descriptors");
+
+        for(int fd : {_timerFd, _eventFd})
+        {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if(::epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+                fail("Cannot add timer descriptor to epoll");
+        }
+    }
+
+    ~TimerFdBackend()
+    {
+        close();
+    }
+
+    TimerFdBackend(const TimerFdBackend&) = delete;
+    TimerFdBackend& operator=(const TimerFdBackend&) = delete;
+
+    [[nodiscard]] int fd() const
+    {
+        return _epollFd;
+    }
+
+    // Clock that the timerfd measures the armed deadline on
+    static clock_type::time_point now()
+    {
+        return clock_type::now();
+    }
+
+    // steady_clock is CLOCK_MONOTONIC, so deadlines are armed as absolute
+    // times as they are
+    void arm(clock_type::time_point deadline)
+    {
+        if(deadline == _deadline)
+            return;
+        _deadline = deadline;
+
+        itimerspec spec{};
+        if(deadline != clock_type::time_point::max())
+        {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          deadline.time_since_epoch())
+                          .count();
+            // Zero would disarm the timer
+            ns = std::max<decltype(ns)>(ns, 1);
+            spec.it_value.tv_sec = ns / 1000000000;
+            spec.it_value.tv_nsec = ns % 1000000000;
+        }
+        ::timerfd_settime(_timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+
+    // Wakeups are sticky until drained, so a notify() before epoll_wait()
+    // is not lost
+    void wait()
+    {
+        epoll_event events[2];
+        while(::epoll_wait(_epollFd, events, 2, -1) < 0 && errno == EINTR)
+        {
+        }
+        drain();
+    }
+
+    void notify()
+    {
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(_eventFd, &one, sizeof(one));
+    }
+
+    // Clear the readiness of both descriptors. The timerfd is re-armed by
+    // the next arm() call, so a drained expiry does not need to be kept.
+    void drain()
+    {
+        std::uint64_t count;
+        [[maybe_unused]] auto expirations =
+            ::read(_timerFd, &count, sizeof(count));
+        [[maybe_unused]] auto notifications =
+            ::read(_eventFd, &count, sizeof(count));
+        // The deadline may have to be armed again after an expiry
+        _deadline = {};
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what)
+    {
+        auto message = what + ": " + std::strerror(errno);
+        close();
+        throw std::runtime_error(message);
+    }
+
+    void close()
+    {
+        for(int fd : {_epollFd, _eventFd, _timerFd})
+        {
+            if(fd >= 0)
+                ::close(fd);
+        }
+        _epollFd = _eventFd = _timerFd = -1;
+    }
+
+    int _timerFd = -1;
+    int _eventFd = -1;
+    int _epollFd = -1;
+    clock_type::time_point _deadline = clock_type::time_point::max();
+};
+
+// Timer waking up through timerfd instead of a condition variable
+using FdTimer = BasicTimer<TimerFdBackend>;
+
+} // namespace mla::timer
+
+#endif // __MLA_TIMERFD_H__
@@ -0,0 +1,620 @@
+#ifndef __MLA_URING_H__
+#define __MLA_URING_H__
+
+#include "mlafw/task.h"
+#include "mlafw/thread.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mla::thread {
+
+template<typename EventType>
+class BlockingEventQueue;
+
+} // namespace mla::thread
+
+namespace detail::util
+{
+
+struct IoOp
+{
+    std::uint8_t opcode;
+    int fd;
+    const void* address;
+    std::size_t length;
+    std::uint64_t offset;
+    std::uint16_t bufferIndex = 0;
+};
+
+} // namespace detail::util
+
+namespace mla::io {
+
+// Result of an operation: bytes transferred, or -errno
+struct IoDone
+{
+    std::uint64_t tag;
+    int result;
+};
+
+// Where the result of an operation goes. complete is called on the thread
+// reaping completions and should hand the result on quickly.
+struct Completion
+{
+    void* target = nullptr;
+    void (*complete)(void* target, std::uint64_t tag, int result) = nullptr;
+    std::uint64_t tag = 0;
+};
+
+// Completion pushing IoDone{tag, result} to queue, e.g. an EventThread
+template<typename EventType>
+Completion pushTo(thread::BlockingEventQueue<EventType>& queue,
+                  std::uint64_t tag = 0)
+{
+    return {&queue,
+            [](void* target, std::uint64_t tag, int result)
+            {
+                static_cast<thread::BlockingEventQueue<EventType>*>(target)
+                    ->push(EventType{IoDone{tag, result}});
+            },
+            tag};
+}
+
+// An io_uring set up with raw syscalls, so no liburing is needed. Not
+// thread-safe: one thread submits, one reaps.
+class IoRing
+{
+public:
+    explicit IoRing(unsigned entries)
+    {
+        // Room for completions of four submission queues in flight
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        _fd = static_cast<int>(
+            ::syscall(__NR_io_uring_setup, entries, &params));
+        if(_fd < 0)
+            fail("Cannot set up io_uring");
+
+        _sqRingSize =
+            params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cqRingSize =
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if(singleMap)
+            _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+
+        _sqRing = map(_sqRingSize, IORING_OFF_SQ_RING);
+        _cqRing = singleMap ? _sqRing : map(_cqRingSize, IORING_OFF_CQ_RING);
+        _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = static_cast<io_uring_sqe*>(map(_sqesSize, IORING_OFF_SQES));
+
+        auto* sq = static_cast<std::byte*>(_sqRing);
+        _sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        _sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        _sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        _sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        _sqEntries = params.sq_entries;
+
+        auto* cq = static_cast<std::byte*>(_cqRing);
+        _cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        _cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        _cqEntries = params.cq_entries;
+    }
+
+    ~IoRing()
+    {
+        close();
+    }
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    // Polls readable while completions are waiting
+    [[nodiscard]] int fd() const
+    {
+        return _fd;
+    }
+
+    // Operations that can be in flight without overflowing the completion
+    // queue
+    [[nodiscard]] unsigned completionEntries() const
+    {
+        return _cqEntries;
+    }
+
+    // Queue an entry filled in by fill(sqe). Returns false if the
+    // submission queue is full.
+    template<typename Fn>
+    bool push(Fn&& fill)
+    {
+        auto tail = *_sqTail;
+        if(tail - load(_sqHead) >= _sqEntries)
+            return false;
+
+        auto index = tail & _sqMask;
+        auto& sqe = _sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        fill(sqe);
+        _sqArray[index] = index;
+        store(_sqTail, tail + 1);
+        ++_pending;
+        return true;
+    }
+
+    // Hand everything queued to the kernel in one io_uring_enter(). Entries
+    // the kernel cannot take yet (EAGAIN, EBUSY) stay queued for the next
+    // call; waiting for them here could stall the thread that reaps.
+    void submit()
+    {
+        while(_pending > 0)
+        {
+            auto submitted =
+                ::syscall(__NR_io_uring_enter, _fd, _pending, 0, 0, nullptr, 0);
+            if(submitted >= 0)
+            {
+                _pending -= static_cast<unsigned>(submitted);
+            }
+            else if(errno == EAGAIN || errno == EBUSY)
+            {
+                return;
+            }
+            else if(errno != EINTR)
+            {
+                throw std::runtime_error(
+                    std::string("Cannot submit to io_uring: ") +
+                    std::strerror(errno));
+            }
+        }
+    }
+
+    // Block until a completion is waiting or a signal arrives
+    void wait()
+    {
+        ::syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS,
+                  nullptr, 0);
+    }
+
+    // Call fn(cqe) for up to max waiting completions. Returns their number.
+    template<typename Fn>
+    unsigned reap(unsigned max, Fn&& fn)
+    {
+        auto head = *_cqHead;
+        const auto tail = load(_cqTail);
+        unsigned count = 0;
+        for(; head != tail && count < max; ++head, ++count)
+            fn(_cqes[head & _cqMask]);
+        store(_cqHead, head);
+        return count;
+    }
+
+    // Pin buffers for the *_FIXED operations, replacing earlier ones
+    void registerBuffers(std::span<const iovec> buffers)
+    {
+        ::syscall(__NR_io_uring_register, _fd, IORING_UNREGISTER_BUFFERS,
+                  nullptr, 0);
+        if(::syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS,
+                     buffers.data(), buffers.size()) < 0)
+            throw std::runtime_error(
+                std::string("Cannot register io_uring buffers: ") +
+                std::strerror(errno));
+    }
+
+private:
+    // The kernel updates the other side of each ring concurrently
+    static unsigned load(unsigned* index)
+    {
+        return std::atomic_ref<unsigned>(*index).load(
+            std::memory_order_acquire);
+    }
+
+    static void store(unsigned* index, unsigned value)
+    {
+        std::atomic_ref<unsigned>(*index).store(value,
+                                                std::memory_order_release);
+    }
+
+    void* map(std::size_t size, off_t offset)
+    {
+        void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, _fd, offset);
+        if(address == MAP_FAILED)
+            fail("Cannot map io_uring");
+        return address;
+    }
+
+    [[noreturn]] void fail(const std::string& what)
+    {
+        auto message = what + ": " + std::strerror(errno);
+        close();
+        throw std::runtime_error(message);
+    }
+
+    void close()
+    {
+        if(_sqes)
+            ::munmap(_sqes, _sqesSize);
+        if(_cqRing && _cqRing != _sqRing)
+            ::munmap(_cqRing, _cqRingSize);
+        if(_sqRing)
+            ::munmap(_sqRing, _sqRingSize);
+        if(_fd >= 0)
+            ::close(_fd);
+        _sqes = nullptr;
+        _sqRing = _cqRing = nullptr;
+        _fd = -1;
+    }
+
+    int _fd = -1;
+    void* _sqRing = nullptr;
+    void* _cqRing = nullptr;
+    std::size_t _sqRingSize = 0;
+    std::size_t _cqRingSize = 0;
+    std::size_t _sqesSize = 0;
+
+    io_uring_sqe* _sqes = nullptr;
+    unsigned* _sqHead = nullptr;
+    unsigned* _sqTail = nullptr;
+    unsigned* _sqArray = nullptr;
+    unsigned _sqMask = 0;
+    unsigned _sqEntries = 0;
+    unsigned _pending = 0;
+
+    io_uring_cqe* _cqes = nullptr;
+    unsigned* _cqHead = nullptr;
+    unsigned* _cqTail = nullptr;
+    unsigned _cqMask = 0;
+    unsigned _cqEntries = 0;
+};
+
+class IoService;
+
+// co_await service.read(...)/write(...) starts the operation and resumes
+// with its result, bytes or -errno, on the awaiting task's EventThread
+class [[nodiscard]] IoAwaiter
+{
+public:
+    IoAwaiter(IoService& service, const detail::util::IoOp& op)
+        : _service(service), _op(op)
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template<typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> caller)
+    {
+        _handle = caller;
+        _scheduler = detail::util::schedulerOf(caller);
+        submit();
+    }
+
+    int await_resume() const noexcept
+    {
+        return _result;
+    }
+
+private:
+    void submit();
+
+    static void deliver(void* self, std::uint64_t, int result)
+    {
+        auto* awaiter = static_cast<IoAwaiter*>(self);
+        awaiter->_result = result;
+        awaiter->_scheduler.schedule(awaiter->_handle);
+    }
+
+    IoService& _service;
+    detail::util::IoOp _op;
+    int _result = 0;
+    thread::Scheduler _scheduler;
+    std::coroutine_handle<> _handle;
+};
+
+// Asynchronous reads and writes through an io_uring, started from any
+// thread, so EventThreads do not stall in write(). Results go to a
+// Completion on the thread reaping them: the service's own thread once
+// started, or whoever calls poll() when fd() polls readable, e.g. a
+// ReactorThread. Operations run concurrently, so file writes whose order
+// matters need explicit offsets. No more operations are in flight than the
+// completion queue holds; the ones over that wait in the service, in order,
+// until earlier ones complete. Operations still in flight or waiting when
+// the service is destroyed are cancelled without completing.
+class IoService : public thread::Thread
+{
+public:
+    // Offset for pipes and sockets; files use and advance their position
+    static constexpr std::uint64_t kNoOffset = ~std::uint64_t{0};
+    static constexpr unsigned kDefaultEntries = 256;
+
+    // Defers io_uring_enter() for the operations this thread starts on
+    // service until the batch ends, so they are submitted together
+    class Batch
+    {
+    public:
+        explicit Batch(IoService& service)
+            : _service(service), _previous(_batching)
+        {
+            _batching = &service;
+        }
+
+        ~Batch()
+        {
+            _batching = _previous;
+            std::lock_guard<std::mutex> lock(_service._mutex);
+            _service._ring.submit();
+        }
+
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+    private:
+        IoService& _service;
+        IoService* _previous;
+    };
+
+    explicit IoService(unsigned entries = kDefaultEntries) : _ring(entries)
+    {
+    }
+
+    // Whether the kernel allows io_uring at all
+    static bool supported()
+    {
+        io_uring_params params{};
+        int fd = static_cast<int>(::syscall(__NR_io_uring_setup, 1, &params));
+        if(fd < 0)
+            return false;
+        ::close(fd);
+        return true;
+    }
+
+    [[nodiscard]] int fd() const
+    {
+        return _ring.fd();
+    }
+
+    // Pin buffers for readFixed() and writeFixed(), which saves mapping
+    // them for every operation. Replaces buffers registered before, so
+    // call it while none of those are in use.
+    void registerBuffers(std::span<const iovec> buffers)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ring.registerBuffers(buffers);
+        _buffers.assign(buffers.begin(), buffers.end());
+    }
+
+    void read(int fd, std::span<std::byte> buffer, std::uint64_t offset,
+              Completion done)
+    {
+        submit({IORING_OP_READ, fd, buffer.data(), buffer.size(), offset},
+              done);
+    }
+
+    void write(int fd, std::span<const std::byte> data, std::uint64_t offset,
+               Completion done)
+    {
+        submit({IORING_OP_WRITE, fd, data.data(), data.size(), offset}, done);
+    }
+
+    // buffer must lie within registered buffer index
+    void readFixed(int fd, std::uint16_t index, std::span<std::byte> buffer,
+                   std::uint64_t offset, Completion done)
+    {
+        submit({IORING_OP_READ_FIXED, fd, buffer.data(), buffer.size(), offset,
+               index},
+              done);
+    }
+
+    void writeFixed(int fd, std::uint16_t index,
+                    std::span<const std::byte> data, std::uint64_t offset,
+                    Completion done)
+    {
+        submit({IORING_OP_WRITE_FIXED, fd, data.data(), data.size(), offset,
+               index},
+              done);
+    }
+
+    IoAwaiter read(int fd, std::span<std::byte> buffer,
+                   std::uint64_t offset = kNoOffset)
+    {
+        return {*this,
+                {IORING_OP_READ, fd, buffer.data(), buffer.size(), offset}};
+    }
+
+    IoAwaiter write(int fd, std::span<const std::byte> data,
+                    std::uint64_t offset = kNoOffset)
+    {
+        return {*this,
+                {IORING_OP_WRITE, fd, data.data(), data.size(), offset}};
+    }
+
+    void execute() override
+    {
+        while(!_shouldExit.load())
+        {
+            _ring.wait();
+            poll();
+        }
+    }
+
+    // The last completion entry is kept for this wakeup, so it gets through
+    // even when operations that may never complete fill the queue
+    void exit() override
+    {
+        _shouldExit.store(true);
+        submit({IORING_OP_NOP, -1, nullptr, 0, 0}, {},
+               _ring.completionEntries());
+    }
+
+    // Deliver the completions that are waiting, without blocking
+    void poll()
+    {
+        constexpr unsigned kReapBatch = 64;
+        Completion done[kReapBatch];
+        int results[kReapBatch];
+
+        unsigned count;
+        do
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                count = _ring.reap(kReapBatch,
+                                   [&, i = 0u](const io_uring_cqe& cqe) mutable
+                                   {
+                                       auto slot = static_cast<std::uint32_t>(
+                                           cqe.user_data);
+                                       done[i] = _slots[slot];
+                                       results[i++] = cqe.res;
+                                       _free.push_back(slot);
+                                   });
+                // Start operations waiting for the room just freed
+                _inFlight -= count;
+                while(!_waiting.empty() &&
+                      enqueue(_waiting.front(), operationLimit()))
+                    _waiting.pop_front();
+                _ring.submit();
+            }
+            for(unsigned i = 0; i < count; ++i)
+            {
+                if(done[i].complete)
+                    done[i].complete(done[i].target, done[i].tag, results[i]);
+            }
+        } while(count == kReapBatch);
+    }
+
+private:
+    friend class IoAwaiter;
+
+    // Operation waiting for room in the completion queue
+    struct Waiting
+    {
+        detail::util::IoOp op;
+        std::uint32_t slot;
+    };
+
+    unsigned operationLimit() const
+    {
+        return _ring.completionEntries() - 1;
+    }
+
+    void submit(const detail::util::IoOp& op, Completion done)
+    {
+        submit(op, done, operationLimit());
+    }
+
+    void submit(const detail::util::IoOp& op, Completion done, unsigned limit)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(op.opcode == IORING_OP_READ_FIXED ||
+           op.opcode == IORING_OP_WRITE_FIXED)
+            checkRegistered(op);
+
+        std::uint32_t slot;
+        if(_free.empty())
+        {
+            slot = static_cast<std::uint32_t>(_slots.size());
+            _slots.push_back(done);
+        }
+        else
+        {
+            slot = _free.back();
+            _free.pop_back();
+            _slots[slot] = done;
+        }
+
+        // Operations keep their order; the wakeup of exit() overtakes them
+        Waiting operation{op, slot};
+        const bool overtake = limit > operationLimit();
+        if((!overtake && !_waiting.empty()) || !enqueue(operation, limit))
+            _waiting.push_back(operation);
+
+        if(_batching != this)
+            _ring.submit();
+    }
+
+    // Queue operation to the ring unless limit operations are in flight or
+    // the submission queue stays full. Called with _mutex held.
+    bool enqueue(const Waiting& operation, unsigned limit)
+    {
+        if(_inFlight >= limit)
+            return false;
+
+        const auto& op = operation.op;
+        auto fill = [&](io_uring_sqe& sqe)
+        {
+            sqe.opcode = op.opcode;
+            sqe.fd = op.fd;
+            sqe.addr = reinterpret_cast<std::uint64_t>(op.address);
+            // Longer transfers complete short, as write() would
+            sqe.len = static_cast<std::uint32_t>(std::min<std::size_t>(
+                op.length, std::numeric_limits<std::uint32_t>::max()));
+            sqe.off = op.offset;
+            sqe.buf_index = op.bufferIndex;
+            sqe.user_data = operation.slot;
+        };
+        if(!_ring.push(fill))
+        {
+            _ring.submit();
+            if(!_ring.push(fill))
+                return false;
+        }
+        ++_inFlight;
+        return true;
+    }
+
+    void checkRegistered(const detail::util::IoOp& op) const
+    {
+        auto* begin = static_cast<const std::byte*>(op.address);
+        if(op.bufferIndex < _buffers.size())
+        {
+            const auto& buffer = _buffers[op.bufferIndex];
+            auto* base = static_cast<const std::byte*>(buffer.iov_base);
+            if(begin >= base && begin + op.length <= base + buffer.iov_len)
+                return;
+        }
+        throw std::runtime_error("Buffer is not registered");
+    }
+
+    static inline thread_local IoService* _batching = nullptr;
+
+    IoRing _ring;
+    std::mutex _mutex;
+    std::vector<Completion> _slots;
+    std::vector<std::uint32_t> _free;
+    std::deque<Waiting> _waiting;
+    unsigned _inFlight = 0;
+    std::vector<iovec> _buffers;
+};
+
+inline void IoAwaiter::submit()
+{
+    _service.submit(_op, {this, &deliver});
+}
+
+} // namespace mla::io
+
+#endif
@@ -1,17 +1,70 @@
 #ifndef __MLA_VECTORQUICKMAP__
 #define __MLA_VECTORQUICKMAP__
 
+#include "detail/bitmaputil.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace mla
 {
 
+template <typename K, typename V>
+    requires(std::is_trivially_copyable_v<K> &&
+             std::is_trivially_copyable_v<V>)
+class MappedQuickMap;
+
+} // namespace mla
+
+namespace detail::util
+{
+
+// On-disk header of a VectorQuickMap snapshot. Entries follow at offset
+// kSnapshotHeaderSize as an image of the hash table, with padding and empty
+// slots zeroed.
+struct QuickMapSnapshotHeader
+{
+    static constexpr std::uint64_t kMagic = 0x50414d4b43495551; // "QUICKMAP"
+    // Slots are placed by std::hash<K>, which is not recorded: a snapshot
+    // can only be mapped by a program whose std::hash<K> matches the
+    // writer's, i.e. built against the same standard library and with the
+    // same specialization for K.
+    static constexpr std::uint32_t kVersion = 1;
+
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t entry_size;
+    std::uint32_t key_size;
+    std::uint32_t value_size;
+    std::uint64_t capacity;
+    std::uint64_t size;
+};
+
+static constexpr std::size_t kSnapshotHeaderSize = 64;
+static_assert(sizeof(QuickMapSnapshotHeader) <= kSnapshotHeaderSize);
+
+} // namespace detail::util
+
+namespace mla
+{
+
 // Vector-based implementation with dynamic resizing
 template <typename K, typename V>
 class VectorQuickMap
 {
+    template <typename MK, typename MV>
+        requires(std::is_trivially_copyable_v<MK> &&
+                 std::is_trivially_copyable_v<MV>)
+    friend class MappedQuickMap;
+
 private:
     struct Entry
     {
@@ -20,6 +73,8 @@ private:
         bool occupied = false;
     };
     std::vector<Entry> data;
+    // One bit per slot so iteration can skip empty slots 64 at a time
+    std::vector<std::uint64_t> occupancy;
     size_t _size = 0;
     float max_load_factor = 0.75f;
 
@@ -36,6 +91,7 @@ private:
         {
             entry.occupied = false;
         }
+        occupancy.assign(detail::util::bitmap_words(new_capacity), 0);
 
         _size = 0;
         for(const auto& entry : old_data)
@@ -47,6 +103,28 @@ private:
         }
     }
 
+    // Shift the rest of the probe chain back into the slot freed by remove()
+    // so that lookups do not stop early at the hole
+    void close_gap(size_t hole)
+    {
+        size_t index = (hole + 1) % data.size();
+        while(data[index].occupied)
+        {
+            size_t home = hash(data[index].key);
+            bool reachable = hole <= index ? (hole < home && home <= index)
+                                           : (hole < home || home <= index);
+            if(!reachable)
+            {
+                data[hole] = std::move(data[index]);
+                data[index].occupied = false;
+                detail::util::set_bit(occupancy.data(), hole);
+                detail::util::clear_bit(occupancy.data(), index);
+                hole = index;
+            }
+            index = (index + 1) % data.size();
+        }
+    }
+
 public:
     class Iterator
     {
@@ -55,10 +133,8 @@ public:
         size_t index;
         void find_next_occupied()
         {
-            while(index < map->data.size() && !map->data[index].occupied)
-            {
-                ++index;
-            }
+            index = detail::util::next_set_bit(map->occupancy.data(),
+                                               map->data.size(), index);
         }
 
     public:
@@ -93,6 +169,7 @@ public:
     VectorQuickMap(size_t initial_capacity = 16)
     {
         data.resize(initial_capacity);
+        occupancy.resize(detail::util::bitmap_words(initial_capacity));
     }
 
     void insert(const K& key, const V& value)
@@ -100,6 +177,7 @@ public:
         if(data.empty())
         {
             data.resize(16);
+            occupancy.resize(detail::util::bitmap_words(16));
         }
 
         if(static_cast<float>(_size + 1) / data.size() > max_load_factor)
@@ -116,6 +194,7 @@ public:
                 if(!data[index].occupied)
                 {
                     _size++;
+                    detail::util::set_bit(occupancy.data(), index);
                 }
                 data[index] = {key, value, true};
                 return;
@@ -170,7 +249,9 @@ public:
             if(data[index].key == key)
             {
                 data[index].occupied = false;
+                detail::util::clear_bit(occupancy.data(), index);
                 _size--;
+                close_gap(index);
                 return;
             }
             index = (index + 1) % data.size();
@@ -225,6 +306,83 @@ public:
     {
         return data.size();
     }
+
+    // Call fn(key, value) for every entry, on the calling thread by
+    // default. With num_threads > 1 the table is split into ranges that are
+    // visited concurrently, so fn must then be safe to call from several
+    // threads at once. An exception from fn is rethrown here.
+    template <typename Fn>
+    void for_each(Fn&& fn, unsigned num_threads = 1)
+    {
+        detail::util::parallel_ranges(
+            data.size(), num_threads,
+            [this, &fn](size_t begin, size_t end)
+            {
+                const auto* words = occupancy.data();
+                for(size_t i = detail::util::next_set_bit(words, end, begin);
+                    i < end; i = detail::util::next_set_bit(words, end, i + 1))
+                {
+                    fn(std::as_const(data[i].key), data[i].value);
+                }
+            });
+    }
+
+    // Write the table as a flat image that MappedQuickMap can map back
+    // without rehashing. Only for trivially copyable keys and values.
+    void dump(const std::string& path) const
+        requires(std::is_trivially_copyable_v<K> &&
+                 std::is_trivially_copyable_v<V>)
+    {
+        static_assert(alignof(Entry) <= detail::util::kSnapshotHeaderSize);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if(!out)
+        {
+            throw std::runtime_error("Cannot open snapshot file: " + path);
+        }
+
+        char header[detail::util::kSnapshotHeaderSize] = {};
+        const detail::util::QuickMapSnapshotHeader h{
+            .magic = detail::util::QuickMapSnapshotHeader::kMagic,
+            .version = detail::util::QuickMapSnapshotHeader::kVersion,
+            .entry_size = sizeof(Entry),
+            .key_size = sizeof(K),
+            .value_size = sizeof(V),
+            .capacity = data.size(),
+            .size = _size};
+        std::memcpy(header, &h, sizeof(h));
+
+        out.write(header, sizeof(header));
+
+        // Entries are copied member by member into a zeroed buffer, so the
+        // file holds no padding bytes or stale keys from memory
+        constexpr size_t chunk_entries = 1024;
+        std::vector<unsigned char> chunk;
+        for(size_t begin = 0; begin < data.size(); begin += chunk_entries)
+        {
+            const size_t count = std::min(chunk_entries, data.size() - begin);
+            chunk.assign(count * sizeof(Entry), 0);
+            auto* entries = reinterpret_cast<Entry*>(chunk.data());
+            for(size_t i = 0; i < count; ++i)
+            {
+                const Entry& entry = data[begin + i];
+                if(!entry.occupied)
+                {
+                    continue;
+                }
+                std::memcpy(&entries[i].key, &entry.key, sizeof(K));
+                std::memcpy(&entries[i].value, &entry.value, sizeof(V));
+                std::memcpy(&entries[i].occupied, &entry.occupied,
+                            sizeof(bool));
+            }
+            out.write(reinterpret_cast<const char*>(chunk.data()),
+                      static_cast<std::streamsize>(chunk.size()));
+        }
+        if(!out)
+        {
+            throw std::runtime_error("Cannot write snapshot file: " + path);
+        }
+    }
 };
 
 } // namespace mla
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include "mlafw/actor.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Increment
+{
+    int amount = 1;
+};
+
+struct Token
+{
+    int hops = 0;
+};
+
+using ActorEvent = std::variant<Increment, Token>;
+
+class CountingActor
+    : public mla::thread::Actor<CountingActor, ActorEvent>
+{
+public:
+    CountingActor(mla::thread::ActorRuntime& runtime, std::atomic<int>& total,
+                  std::atomic<int>& overlaps)
+        : Actor(runtime), total(total), overlaps(overlaps)
+    {
+    }
+
+    void onEvent(const Increment& event)
+    {
+        if(busy.exchange(true))
+            overlaps++;
+        count += event.amount;
+        total += event.amount;
+        busy.store(false);
+    }
+
+    // Pass the token on until it has done enough hops
+    void onEvent(const Token& event)
+    {
+        total++;
+        if(event.hops > 1)
+            next->push(Token{event.hops - 1});
+    }
+
+    int count = 0;
+    CountingActor* next = nullptr;
+    std::atomic<int>& total;
+    std::atomic<int>& overlaps;
+    std::atomic<bool> busy{false};
+};
+
+void waitFor(const std::atomic<int>& value, int expected)
+{
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(value.load() < expected && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+}
+
+} // namespace
+
+TEST(ActorTest, DeliversAllEvents)
+{
+    constexpr int NUM_ACTORS = 1000;
+    constexpr int EVENTS_PER_ACTOR = 100;
+
+    std::atomic<int> total{0};
+    std::atomic<int> overlaps{0};
+    mla::thread::ActorRuntime runtime(4, 8);
+
+    std::vector<std::unique_ptr<CountingActor>> actors;
+    for(int i = 0; i < NUM_ACTORS; ++i)
+        actors.push_back(
+            std::make_unique<CountingActor>(runtime, total, overlaps));
+
+    runtime.start();
+
+    std::vector<std::jthread> producers;
+    for(int p = 0; p < 4; ++p)
+        producers.emplace_back(
+            [&]
+            {
+                for(int j = 0; j < EVENTS_PER_ACTOR / 4; ++j)
+                    for(auto& actor : actors)
+                        actor->push(Increment{});
+            });
+    producers.clear();
+
+    waitFor(total, NUM_ACTORS * EVENTS_PER_ACTOR);
+    runtime.stop();
+    runtime.join();
+
+    EXPECT_EQ(total, NUM_ACTORS * EVENTS_PER_ACTOR);
+    EXPECT_EQ(overlaps, 0);
+    for(auto& actor : actors)
+        EXPECT_EQ(actor->count, EVENTS_PER_ACTOR);
+}
+
+TEST(ActorTest, ActorsMessageEachOther)
+{
+    constexpr int NUM_ACTORS = 100;
+    constexpr int HOPS = 10000;
+
+    std::atomic<int> total{0};
+    std::atomic<int> overlaps{0};
+    mla::thread::ActorRuntime runtime(2);
+
+    std::vector<std::unique_ptr<CountingActor>> actors;
+    for(int i = 0; i < NUM_ACTORS; ++i)
+        actors.push_back(
+            std::make_unique<CountingActor>(runtime, total, overlaps));
+    for(int i = 0; i < NUM_ACTORS; ++i)
+        actors[i]->next = actors[(i + 1) % NUM_ACTORS].get();
+
+    runtime.start();
+    actors[0]->push(Token{HOPS});
+
+    waitFor(total, HOPS);
+    runtime.stop();
+    runtime.join();
+
+    EXPECT_EQ(total, HOPS);
+}
+
+TEST(ActorTest, RejectsZeroWorkers)
+{
+    EXPECT_THROW(mla::thread::ActorRuntime(0), std::runtime_error);
+}
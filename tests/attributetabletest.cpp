@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "mlafw/attributetable.h"
+
+#include <bit>
+#include <string>
+
+using namespace mla::util;
+
+namespace {
+
+struct PriceTag {};
+struct QuantityTag {};
+
+using Price = Attribute<double, PriceTag>;
+using Quantity = Attribute<int, QuantityTag>;
+using Table = AttributeTable<Price, Quantity, std::string>;
+
+} // namespace
+
+TEST(AttributeTableTest, RowViews)
+{
+    Table table;
+    EXPECT_TRUE(table.empty());
+
+    table.push_back(Table::row_type(Price(1.5), Quantity(2), "first"));
+    auto row = table.emplace_back();
+    row.set(Quantity(5));
+
+    ASSERT_EQ(table.size(), 2u);
+    EXPECT_EQ(table[0].get<Price>()->get(), 1.5);
+    EXPECT_EQ(table[0].get<std::string>(), std::optional<std::string>("first"));
+    EXPECT_FALSE(table[1].has<Price>());
+    EXPECT_FALSE(table[1].get<Price>().has_value());
+    EXPECT_EQ(table[1].get<Quantity>()->get(), 5);
+    EXPECT_FALSE(table[1].has<double>());
+    static_assert(Table::const_row_view::contains<Quantity>());
+
+    auto tuple = table[1].tuple();
+    EXPECT_FALSE(tuple.has<Price>());
+    EXPECT_EQ(tuple.get<Quantity>()->get(), 5);
+    EXPECT_FALSE(tuple.dirty());
+    EXPECT_FALSE(table[0].tuple().dirty());
+
+    table.reset<Quantity>(1);
+    EXPECT_FALSE(table[1].has<Quantity>());
+    EXPECT_EQ(table.column<Quantity>()[1].get(), 0);
+}
+
+TEST(AttributeTableTest, Columns)
+{
+    constexpr int NUM_ROWS = 1000;
+
+    Table table;
+    table.reserve(NUM_ROWS);
+    for(int i = 0; i < NUM_ROWS; ++i)
+    {
+        auto row = table.emplace_back();
+        if(i % 2 == 0)
+            row.set(Price(i));
+        row.set(Quantity(i));
+    }
+
+    // Unset prices are zero, so the column sums up as it is
+    auto prices = table.column<Price>();
+    ASSERT_EQ(prices.size(), static_cast<std::size_t>(NUM_ROWS));
+    double sum = 0;
+    for(const auto& price : prices)
+        sum += price.get();
+    EXPECT_EQ(sum, 249500.0);
+
+    auto present = table.present<Price>();
+    ASSERT_EQ(present.size(), 16u);
+    EXPECT_EQ(present[0], 0x5555555555555555ull);
+    std::size_t count = 0;
+    for(auto word : present)
+        count += std::popcount(word);
+    EXPECT_EQ(count, static_cast<std::size_t>(NUM_ROWS / 2));
+
+    const auto& constTable = table;
+    EXPECT_TRUE(constTable[998].has<Price>());
+    EXPECT_FALSE(constTable[999].has<Price>());
+    EXPECT_EQ(constTable.column<Quantity>()[999].get(), 999);
+
+    table.clear();
+    EXPECT_TRUE(table.empty());
+    EXPECT_TRUE(table.present<Price>().empty());
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
+#include "mlafw/attributedelta.h"
 #include "mlafw/attributetuple.h"
+#include "mlafw/attributewire.h"
+#include "mlafw/eventthread.h"
 
 using namespace mla::util;
 
@@ -212,3 +215,266 @@ TEST_F(AttributeTest, NonPrimitiveTypeVectorModification)
     EXPECT_EQ(attrVec.get().size(), 1);
     EXPECT_EQ(attrVec.get()[0], 42);
 }
+
+template <int N>
+struct Field
+{
+};
+
+template <int N>
+using IntField = Attribute<int, Field<N>>;
+
+template <int N>
+using DoubleField = Attribute<double, Field<N>>;
+
+TEST(AttributeTupleTest, PackedSize)
+{
+    static_assert(sizeof(Attribute<int>) == sizeof(int));
+    static_assert(sizeof(Attribute<double>) == sizeof(double));
+
+    // Fields are placed by alignment, followed by a byte of presence bits
+    // and a byte of dirty bits
+    static_assert(sizeof(AttributeTuple<int, double>) == 16);
+    static_assert(sizeof(AttributeTuple<char, double, char, int>) == 16);
+    static_assert(sizeof(AttributeTuple<char, short, char>) == 6);
+
+    // 20 ints and doubles with 32 presence and 32 dirty bits
+    using Wide = AttributeTuple<
+        IntField<0>, DoubleField<1>, IntField<2>, DoubleField<3>, IntField<4>,
+        DoubleField<5>, IntField<6>, DoubleField<7>, IntField<8>,
+        DoubleField<9>, IntField<10>, DoubleField<11>, IntField<12>,
+        DoubleField<13>, IntField<14>, DoubleField<15>, IntField<16>,
+        DoubleField<17>, IntField<18>, DoubleField<19>>;
+    static_assert(sizeof(Wide) == 128);
+    static_assert(std::is_trivially_copyable_v<Wide>);
+
+    Wide wide;
+    wide.set<DoubleField<19>>(2.5);
+    wide.set<IntField<0>>(7);
+    EXPECT_TRUE(wide.has<DoubleField<19>>());
+    EXPECT_FALSE(wide.has<DoubleField<17>>());
+    EXPECT_EQ(wide.get<DoubleField<19>>()->get(), 2.5);
+    EXPECT_EQ(wide.get<IntField<0>>()->get(), 7);
+
+    Wide copy = wide;
+    EXPECT_EQ(copy.get<DoubleField<19>>()->get(), 2.5);
+    EXPECT_FALSE(copy.has<IntField<2>>());
+}
+
+TEST(AttributeTupleTest, NonTrivialLifetime)
+{
+    auto shared = std::make_shared<int>(1);
+    {
+        AttributeTuple<int, std::shared_ptr<int>, std::string> attr;
+        attr.set<std::shared_ptr<int>>(shared);
+        EXPECT_EQ(shared.use_count(), 2);
+
+        auto copy = attr;
+        EXPECT_EQ(shared.use_count(), 3);
+        EXPECT_FALSE(copy.has<int>());
+
+        auto moved = std::move(copy);
+        EXPECT_EQ(shared.use_count(), 3);
+        EXPECT_FALSE(copy.has<std::shared_ptr<int>>());
+
+        moved.set<std::string>("long enough to live on the heap");
+        attr = moved;
+        EXPECT_EQ(attr.get<std::string>(),
+                  std::optional<std::string>(
+                      "long enough to live on the heap"));
+        EXPECT_EQ(shared.use_count(), 3);
+    }
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(AttributeTupleTest, WireFormat)
+{
+    using Wire = AttributeTuple<char, double, IntField<0>>;
+    static_assert(wire_size_v<Wire> == 1 + 1 + 8 + 4);
+
+    Wire tuple;
+    tuple.set<double>(2.5);
+    tuple.set<IntField<0>>(IntField<0>(-7));
+
+    std::array<std::byte, wire_size_v<Wire> + 1> buffer{};
+    EXPECT_EQ(encode(tuple, buffer), wire_size_v<Wire>);
+    EXPECT_EQ(buffer[0], std::byte{0b110});
+
+    // Read from an unaligned position
+    std::array<std::byte, wire_size_v<Wire> + 1> shifted{};
+    std::copy(buffer.begin(), buffer.end() - 1, shifted.begin() + 1);
+    std::span<const std::byte> received(shifted.data() + 1, buffer.size() - 1);
+    AttributeTupleView<char, double, IntField<0>> view(received);
+    EXPECT_FALSE(view.has<char>());
+    EXPECT_FALSE(view.get<char>().has_value());
+    EXPECT_EQ(view.get<double>(), std::optional<double>(2.5));
+    EXPECT_EQ(view.get<IntField<0>>()->get(), -7);
+    EXPECT_EQ(view.data().data(), shifted.data() + 1);
+
+    auto decoded = view.tuple();
+    EXPECT_FALSE(decoded.has<char>());
+    EXPECT_EQ(decoded.get<double>(), std::optional<double>(2.5));
+    EXPECT_EQ(decoded.get<IntField<0>>()->get(), -7);
+    EXPECT_FALSE(decoded.dirty());
+
+    std::array<std::byte, 4> small{};
+    EXPECT_THROW(encode(tuple, small), std::runtime_error);
+    EXPECT_THROW((AttributeTupleView<char, double, IntField<0>>(small)),
+                 std::runtime_error);
+}
+
+TEST(AttributeTupleTest, DirtyTracking)
+{
+    AttributeTuple<int, float, std::string> attr(1, 2.0f, "three");
+    EXPECT_TRUE(attr.dirty());
+    attr.clearDirty();
+    EXPECT_FALSE(attr.dirty());
+
+    attr.set<float>(2.5f);
+    attr.reset<std::string>();
+    EXPECT_FALSE(attr.dirty<int>());
+    EXPECT_TRUE(attr.dirty<float>());
+    EXPECT_TRUE(attr.dirty<std::string>());
+    EXPECT_FALSE(attr.dirty<double>());
+    EXPECT_FALSE(attr.has<std::string>());
+
+    // Copies keep the dirty bits
+    auto copy = attr;
+    EXPECT_TRUE(copy.dirty<float>());
+    EXPECT_FALSE(copy.dirty<int>());
+}
+
+namespace {
+
+using Tracked = AttributeTuple<IntField<0>, DoubleField<1>, IntField<2>,
+                               DoubleField<3>, char>;
+using TrackedDelta = AttributeDelta<IntField<0>, DoubleField<1>, IntField<2>,
+                                    DoubleField<3>, char>;
+
+} // namespace
+
+TEST(AttributeTupleTest, DiffAndApply)
+{
+    Tracked from(IntField<0>(1), DoubleField<1>(2.0), IntField<2>(3),
+                 DoubleField<3>(4.0), 'a');
+    Tracked to = from;
+    to.set<DoubleField<3>>(DoubleField<3>(4.5));
+    to.reset<IntField<0>>();
+
+    auto delta = diff(from, to);
+    EXPECT_EQ(delta.size(), 2u);
+    EXPECT_EQ(delta.bytes(), sizeof(double));
+    // Values are held inline, so deltas copy without allocating
+    static_assert(std::is_trivially_copyable_v<decltype(delta)>);
+    EXPECT_TRUE(delta.changed<IntField<0>>());
+    EXPECT_FALSE(delta.changed<DoubleField<1>>());
+    EXPECT_FALSE(delta.get<IntField<0>>().has_value());
+    EXPECT_EQ(delta.get<DoubleField<3>>()->get(), 4.5);
+
+    from.clearDirty();
+    apply(from, delta);
+    EXPECT_FALSE(from.has<IntField<0>>());
+    EXPECT_EQ(from.get<DoubleField<3>>()->get(), 4.5);
+    EXPECT_EQ(from.get<char>(), std::optional<char>('a'));
+    EXPECT_TRUE(from.dirty<DoubleField<3>>());
+    EXPECT_FALSE(from.dirty<char>());
+    EXPECT_TRUE(diff(from, to).empty());
+
+    // Changes tracked on the tuple itself
+    to.clearDirty();
+    to.set<char>('b');
+    to.set<IntField<2>>(IntField<2>(30));
+    TrackedDelta changes;
+    takeChanges(to, changes);
+    EXPECT_FALSE(to.dirty());
+    EXPECT_EQ(changes.size(), 2u);
+    EXPECT_EQ(changes.bytes(), sizeof(int) + sizeof(char));
+
+    apply(from, changes);
+    EXPECT_EQ(from.get<char>(), std::optional<char>('b'));
+    EXPECT_EQ(from.get<IntField<2>>()->get(), 30);
+    EXPECT_TRUE(diff(from, to).empty());
+}
+
+namespace {
+
+using DeltaEvent = std::variant<std::monostate, TrackedDelta>;
+
+class Replica : public mla::thread::EventThread<Replica, DeltaEvent>
+{
+public:
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const TrackedDelta& delta)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        apply(tuple, delta);
+        ++applied;
+    }
+
+    std::mutex mutex;
+    Tracked tuple;
+    std::atomic<int> applied{0};
+};
+
+} // namespace
+
+TEST(AttributeTupleTest, DeltaAsEvent)
+{
+    Replica replica;
+    replica.start();
+
+    Tracked source;
+    for(int i = 0; i < 10; ++i)
+    {
+        source.set<IntField<2>>(IntField<2>(i));
+        if(i % 3 == 0)
+            source.set<char>(static_cast<char>('a' + i));
+        replica.push(DeltaEvent{takeChanges(source)});
+    }
+
+    while(replica.applied < 10)
+        std::this_thread::yield();
+    replica.exit();
+    replica.join();
+
+    EXPECT_EQ(replica.tuple.get<IntField<2>>()->get(), 9);
+    EXPECT_EQ(replica.tuple.get<char>(), std::optional<char>('j'));
+    EXPECT_FALSE(replica.tuple.has<IntField<0>>());
+}
+
+TEST(AttributeTupleTest, Format)
+{
+    struct NameTag
+    {
+        static constexpr std::string_view name() { return "Name"; }
+    };
+    using AttrName = Attribute<std::string, NameTag>;
+
+    EXPECT_EQ(std::format("{}", AttrName("Joe")), "Name:Joe");
+    EXPECT_EQ(std::format("{}", Attribute<int>(7)), "7");
+
+    AttributeTuple<int, float, std::string> attr(100, 2.718f, "World");
+    std::stringstream ss;
+    ss << attr;
+    EXPECT_EQ(std::format("{}", attr), ss.str());
+
+    attr.reset<float>();
+    EXPECT_EQ(std::format("{}", attr), "(100, , World)");
+
+    // Values are formatted by std::format, not by the stream
+    AttributeTuple<double, bool> exact(1.0 / 3, true);
+    EXPECT_EQ(std::format("{}", exact), "(0.3333333333333333, true)");
+    std::stringstream streamed;
+    streamed << exact;
+    EXPECT_EQ(streamed.str(), "(0.333333, 1)");
+
+    // Straight into a caller's buffer
+    AttributeTuple<AttrName, IntField<0>> named(AttrName("Ann"),
+                                                IntField<0>(3));
+    char buffer[32];
+    auto result = std::format_to_n(buffer, sizeof(buffer), "[{}]", named);
+    EXPECT_EQ(std::string_view(buffer, result.out), "[(Name:Ann, 3)]");
+    EXPECT_EQ(named.get_if<IntField<0>>()->get(), 3);
+    EXPECT_EQ(AttributeTuple<int>().get_if<int>(), nullptr);
+}
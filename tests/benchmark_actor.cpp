@@ -0,0 +1,118 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/actor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace {
+
+constexpr int kNumActors = 10000;
+
+struct Work {
+    std::int64_t value = 0;
+};
+
+struct Token {
+    int hops = 0;
+};
+
+using Event = std::variant<Work, Token>;
+
+class BenchActor : public mla::thread::Actor<BenchActor, Event> {
+public:
+    BenchActor(mla::thread::ActorRuntime& runtime,
+               std::atomic<std::int64_t>& processed)
+        : Actor(runtime), processed(processed) {}
+
+    void onEvent(const Work& event) {
+        sum += event.value;
+        processed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void onEvent(const Token& event) {
+        processed.fetch_add(1, std::memory_order_relaxed);
+        if (event.hops > 1) {
+            next->push(Token{event.hops - 1});
+        }
+    }
+
+    std::int64_t sum = 0;
+    BenchActor* next = nullptr;
+    std::atomic<std::int64_t>& processed;
+};
+
+struct Fixture {
+    explicit Fixture(std::size_t workers) : runtime(workers) {
+        actors.reserve(kNumActors);
+        for (int i = 0; i < kNumActors; ++i) {
+            actors.push_back(std::make_unique<BenchActor>(runtime, processed));
+        }
+        for (int i = 0; i < kNumActors; ++i) {
+            actors[i]->next = actors[(i + 1) % kNumActors].get();
+        }
+        runtime.start();
+    }
+
+    ~Fixture() {
+        runtime.stop();
+        runtime.join();
+    }
+
+    void waitFor(std::int64_t count) {
+        while (processed.load(std::memory_order_relaxed) < count) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::atomic<std::int64_t> processed{0};
+    mla::thread::ActorRuntime runtime;
+    std::vector<std::unique_ptr<BenchActor>> actors;
+};
+
+} // namespace
+
+// One external producer sends 10 events to each of 10k actors, range(0)
+// workers process them
+static void BM_ActorFanOut(benchmark::State& state) {
+    constexpr int kEventsPerActor = 10;
+    Fixture fixture(static_cast<std::size_t>(state.range(0)));
+
+    std::int64_t expected = 0;
+    for (auto _ : state) {
+        for (int j = 0; j < kEventsPerActor; ++j) {
+            for (auto& actor : fixture.actors) {
+                actor->push(Work{j});
+            }
+        }
+        expected += kEventsPerActor * kNumActors;
+        fixture.waitFor(expected);
+    }
+    state.SetItemsProcessed(expected);
+}
+
+// 1000 tokens circulate around a ring of 10k actors, so every event is
+// sent from one actor to another
+static void BM_ActorRing(benchmark::State& state) {
+    constexpr int kTokens = 1000;
+    constexpr int kHops = 100;
+    Fixture fixture(static_cast<std::size_t>(state.range(0)));
+
+    std::int64_t expected = 0;
+    for (auto _ : state) {
+        for (int t = 0; t < kTokens; ++t) {
+            fixture.actors[t * (kNumActors / kTokens)]->push(Token{kHops});
+        }
+        expected += kTokens * kHops;
+        fixture.waitFor(expected);
+    }
+    state.SetItemsProcessed(expected);
+}
+
+BENCHMARK(BM_ActorFanOut)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_ActorRing)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
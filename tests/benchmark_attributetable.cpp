@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/attributetable.h"
+#include "mlafw/attributetuple.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace mla::util;
+
+namespace {
+
+template <int N>
+struct Field {};
+
+template <int N>
+using IntField = Attribute<int, Field<N>>;
+
+template <int N>
+using DoubleField = Attribute<double, Field<N>>;
+
+// 20 ints and doubles, the shape of our typical records
+template <template <typename...> class Container>
+using Records = Container<
+    IntField<0>, DoubleField<1>, IntField<2>, DoubleField<3>, IntField<4>,
+    DoubleField<5>, IntField<6>, DoubleField<7>, IntField<8>, DoubleField<9>,
+    IntField<10>, DoubleField<11>, IntField<12>, DoubleField<13>,
+    IntField<14>, DoubleField<15>, IntField<16>, DoubleField<17>,
+    IntField<18>, DoubleField<19>>;
+
+using Tuple = Records<AttributeTuple>;
+using Table = Records<AttributeTable>;
+
+using Price = DoubleField<7>;
+using Quantity = IntField<12>;
+
+std::vector<Tuple> makeTuples(std::size_t count) {
+    std::vector<Tuple> tuples(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        tuples[i].set<Price>(Price(static_cast<double>(i % 100)));
+        if (i % 3 != 0) {
+            tuples[i].set<Quantity>(Quantity(static_cast<int>(i % 7)));
+        }
+    }
+    return tuples;
+}
+
+Table makeTable(const std::vector<Tuple>& tuples) {
+    Table table;
+    table.reserve(tuples.size());
+    for (const auto& tuple : tuples) {
+        table.push_back(tuple);
+    }
+    return table;
+}
+
+} // namespace
+
+// Sum of all prices over range(0) records
+static void BM_SumTuples(benchmark::State& state) {
+    auto tuples = makeTuples(state.range(0));
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& tuple : tuples) {
+            if (tuple.has<Price>()) {
+                sum += tuple.get<Price>()->get();
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SumTuples)->Arg(1 << 20);
+
+static void BM_SumColumn(benchmark::State& state) {
+    auto table = makeTable(makeTuples(state.range(0)));
+    for (auto _ : state) {
+        // Unset prices are zero
+        double sum = 0;
+        for (const auto& price : table.column<Price>()) {
+            sum += price.get();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SumColumn)->Arg(1 << 20);
+
+// Sum of the prices of records with a quantity above 3
+static void BM_FilterTuples(benchmark::State& state) {
+    auto tuples = makeTuples(state.range(0));
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& tuple : tuples) {
+            auto quantity = tuple.get<Quantity>();
+            if (quantity && quantity->get() > 3 && tuple.has<Price>()) {
+                sum += tuple.get<Price>()->get();
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FilterTuples)->Arg(1 << 20);
+
+static void BM_FilterColumns(benchmark::State& state) {
+    auto table = makeTable(makeTuples(state.range(0)));
+    for (auto _ : state) {
+        // Unset quantities are zero and never pass the filter
+        auto prices = table.column<Price>();
+        auto quantities = table.column<Quantity>();
+        double sum = 0;
+        for (std::size_t i = 0; i < prices.size(); ++i) {
+            sum += quantities[i].get() > 3 ? prices[i].get() : 0.0;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FilterColumns)->Arg(1 << 20);
+
+BENCHMARK_MAIN();
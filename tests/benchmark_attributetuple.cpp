@@ -0,0 +1,306 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/attributedelta.h"
+#include "mlafw/attributetuple.h"
+#include "mlafw/attributewire.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+using namespace mla::util;
+
+namespace {
+
+template <int N>
+struct Field {};
+
+template <int N>
+using IntField = Attribute<int, Field<N>>;
+
+template <int N>
+using DoubleField = Attribute<double, Field<N>>;
+
+// 20 ints and doubles, the shape of our typical records
+template <template <typename...> class Tuple>
+using Record = Tuple<
+    IntField<0>, DoubleField<1>, IntField<2>, DoubleField<3>, IntField<4>,
+    DoubleField<5>, IntField<6>, DoubleField<7>, IntField<8>, DoubleField<9>,
+    IntField<10>, DoubleField<11>, IntField<12>, DoubleField<13>,
+    IntField<14>, DoubleField<15>, IntField<16>, DoubleField<17>,
+    IntField<18>, DoubleField<19>>;
+
+// The layout AttributeTuple had before: an optional per field, each
+// wrapping an Attribute that held an optional of its own
+template <typename... Ts>
+using OptionalTuple = std::tuple<std::optional<std::optional<Ts>>...>;
+
+using Price = DoubleField<7>;
+using Quantity = IntField<12>;
+
+std::vector<Record<AttributeTuple>> makePacked(std::size_t count) {
+    std::vector<Record<AttributeTuple>> records(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        records[i].set<Price>(Price(static_cast<double>(i % 100)));
+        if (i % 3 != 0) {
+            records[i].set<Quantity>(Quantity(static_cast<int>(i % 7)));
+        }
+    }
+    return records;
+}
+
+std::vector<Record<OptionalTuple>> makeOptional(std::size_t count) {
+    std::vector<Record<OptionalTuple>> records(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::get<std::optional<std::optional<Price>>>(records[i]) =
+            Price(static_cast<double>(i % 100));
+        if (i % 3 != 0) {
+            std::get<std::optional<std::optional<Quantity>>>(records[i]) =
+                Quantity(static_cast<int>(i % 7));
+        }
+    }
+    return records;
+}
+
+} // namespace
+
+// Sum price * quantity over range(0) records where both are set
+static void BM_ScanPacked(benchmark::State& state) {
+    auto records = makePacked(state.range(0));
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& record : records) {
+            if (record.has<Price>() && record.has<Quantity>()) {
+                sum += record.get<Price>()->get() *
+                       record.get<Quantity>()->get();
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["bytes_per_record"] = sizeof(Record<AttributeTuple>);
+}
+BENCHMARK(BM_ScanPacked)->Arg(1 << 20);
+
+static void BM_ScanOptional(benchmark::State& state) {
+    auto records = makeOptional(state.range(0));
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& record : records) {
+            const auto& price =
+                std::get<std::optional<std::optional<Price>>>(record);
+            const auto& quantity =
+                std::get<std::optional<std::optional<Quantity>>>(record);
+            if (price && quantity) {
+                sum += (*price)->get() * (*quantity)->get();
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["bytes_per_record"] = sizeof(Record<OptionalTuple>);
+}
+BENCHMARK(BM_ScanOptional)->Arg(1 << 20);
+
+namespace {
+
+// What a hand-written serializer of such a record sends: a flat struct
+struct PlainRecord {
+    int ints[10];
+    double doubles[10];
+};
+
+constexpr std::size_t kWireRecords = 1024;
+
+} // namespace
+
+// Encode kWireRecords records into one buffer
+static void BM_EncodeTuple(benchmark::State& state) {
+    auto records = makePacked(kWireRecords);
+    constexpr auto size = wire_size_v<Record<AttributeTuple>>;
+    std::vector<std::byte> buffer(kWireRecords * size);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < kWireRecords; ++i) {
+            encode(records[i], std::span(buffer).subspan(i * size, size));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    state.SetItemsProcessed(state.iterations() * kWireRecords);
+}
+BENCHMARK(BM_EncodeTuple);
+
+static void BM_EncodeMemcpy(benchmark::State& state) {
+    std::vector<PlainRecord> records(kWireRecords);
+    std::vector<std::byte> buffer(kWireRecords * sizeof(PlainRecord));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < kWireRecords; ++i) {
+            std::memcpy(buffer.data() + i * sizeof(PlainRecord), &records[i],
+                        sizeof(PlainRecord));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    state.SetItemsProcessed(state.iterations() * kWireRecords);
+}
+BENCHMARK(BM_EncodeMemcpy);
+
+// Decode every record of the buffer into a tuple
+static void BM_DecodeTuple(benchmark::State& state) {
+    auto records = makePacked(kWireRecords);
+    constexpr auto size = wire_size_v<Record<AttributeTuple>>;
+    std::vector<std::byte> buffer(kWireRecords * size);
+    for (std::size_t i = 0; i < kWireRecords; ++i) {
+        encode(records[i], std::span(buffer).subspan(i * size, size));
+    }
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < kWireRecords; ++i) {
+            Record<AttributeTupleView> view{
+                std::span(buffer).subspan(i * size, size)};
+            records[i] = view.tuple();
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    state.SetItemsProcessed(state.iterations() * kWireRecords);
+}
+BENCHMARK(BM_DecodeTuple);
+
+// Read one field of every record in place
+static void BM_ReadView(benchmark::State& state) {
+    auto records = makePacked(kWireRecords);
+    constexpr auto size = wire_size_v<Record<AttributeTuple>>;
+    std::vector<std::byte> buffer(kWireRecords * size);
+    for (std::size_t i = 0; i < kWireRecords; ++i) {
+        encode(records[i], std::span(buffer).subspan(i * size, size));
+    }
+
+    for (auto _ : state) {
+        double sum = 0;
+        for (std::size_t i = 0; i < kWireRecords; ++i) {
+            Record<AttributeTupleView> view{
+                std::span(buffer).subspan(i * size, size)};
+            if (auto price = view.get<Price>()) {
+                sum += price->get();
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * kWireRecords);
+}
+BENCHMARK(BM_ReadView);
+
+static void BM_DecodeMemcpy(benchmark::State& state) {
+    std::vector<PlainRecord> records(kWireRecords);
+    std::vector<std::byte> buffer(kWireRecords * sizeof(PlainRecord));
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < kWireRecords; ++i) {
+            std::memcpy(&records[i], buffer.data() + i * sizeof(PlainRecord),
+                        sizeof(PlainRecord));
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    state.SetItemsProcessed(state.iterations() * kWireRecords);
+}
+BENCHMARK(BM_DecodeMemcpy);
+
+// Forward an update of one attribute to a replica by copying the whole
+// record, as our EventThreads do today
+static void BM_UpdateWholeTuple(benchmark::State& state) {
+    auto records = makePacked(1);
+    auto& source = records[0];
+    Record<AttributeTuple> message;
+    Record<AttributeTuple> replica;
+    double price = 0;
+    for (auto _ : state) {
+        source.set<Price>(Price(price += 1));
+        message = source;
+        benchmark::DoNotOptimize(message);
+        replica = message;
+    }
+    benchmark::DoNotOptimize(replica);
+    state.counters["bytes_per_message"] = sizeof(message);
+}
+BENCHMARK(BM_UpdateWholeTuple);
+
+// The same with a delta of the dirty attributes
+static void BM_UpdateDelta(benchmark::State& state) {
+    auto records = makePacked(1);
+    auto& source = records[0];
+    Record<AttributeDelta> message;
+    Record<AttributeTuple> replica;
+    double price = 0;
+    for (auto _ : state) {
+        source.set<Price>(Price(price += 1));
+        takeChanges(source, message);
+        benchmark::DoNotOptimize(message);
+        apply(replica, message);
+    }
+    benchmark::DoNotOptimize(replica);
+    state.counters["bytes_per_message"] = message.bytes();
+    state.counters["object_bytes"] = sizeof(message);
+}
+BENCHMARK(BM_UpdateDelta);
+
+// The same with a new delta per update, as when each one is pushed to an
+// EventThread as an event of its own
+static void BM_UpdateFreshDelta(benchmark::State& state) {
+    auto records = makePacked(1);
+    auto& source = records[0];
+    Record<AttributeTuple> replica;
+    double price = 0;
+    for (auto _ : state) {
+        source.set<Price>(Price(price += 1));
+        auto message = takeChanges(source);
+        benchmark::DoNotOptimize(message);
+        apply(replica, message);
+    }
+    benchmark::DoNotOptimize(replica);
+}
+BENCHMARK(BM_UpdateFreshDelta);
+
+namespace {
+
+struct SymbolTag {
+    static constexpr std::string_view name() { return "symbol"; }
+};
+
+using Symbol = Attribute<std::string, SymbolTag>;
+using LogRecord = AttributeTuple<Symbol, Price, Quantity>;
+
+} // namespace
+
+// Print a record for a log line through operator<<
+static void BM_PrintOstream(benchmark::State& state) {
+    LogRecord record(Symbol("ACME"), Price(101.25), Quantity(300));
+    for (auto _ : state) {
+        std::ostringstream stream;
+        stream << record;
+        benchmark::DoNotOptimize(stream.str());
+    }
+}
+BENCHMARK(BM_PrintOstream);
+
+// The same through std::formatter into a reused buffer
+static void BM_FormatTo(benchmark::State& state) {
+    LogRecord record(Symbol("ACME"), Price(101.25), Quantity(300));
+    std::string line;
+    for (auto _ : state) {
+        line.clear();
+        std::format_to(std::back_inserter(line), "{}", record);
+        benchmark::DoNotOptimize(line.data());
+    }
+}
+BENCHMARK(BM_FormatTo);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/clock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using mla::clock::FastClock;
+
+static void BM_SteadyClockNow(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(std::chrono::steady_clock::now());
+    }
+}
+BENCHMARK(BM_SteadyClockNow);
+
+static void BM_SystemClockNow(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(std::chrono::system_clock::now());
+    }
+}
+BENCHMARK(BM_SystemClockNow);
+
+static void BM_FastClockNow(benchmark::State& state) {
+    state.counters["tsc"] = benchmark::Counter(
+        FastClock::usingTsc(), benchmark::Counter::kAvgThreads);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(FastClock::now());
+    }
+}
+BENCHMARK(BM_FastClockNow)->ThreadRange(1, 4);
+
+static void BM_FastClockWallNow(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(FastClock::wallNow());
+    }
+}
+BENCHMARK(BM_FastClockWallNow);
+
+// Distance from steady_clock, sampled every range(0) microseconds over a
+// few recalibration intervals, in nanoseconds
+static void BM_FastClockDrift(benchmark::State& state) {
+    const std::chrono::microseconds pause(state.range(0));
+    std::vector<double> drift;
+    drift.reserve(state.max_iterations);
+
+    for (auto _ : state) {
+        std::this_thread::sleep_for(pause);
+        auto before = std::chrono::steady_clock::now();
+        auto now = FastClock::now();
+        auto after = std::chrono::steady_clock::now();
+        auto steady = before + (after - before) / 2;
+        drift.push_back(std::abs(
+            std::chrono::duration<double, std::nano>(now - steady).count()));
+    }
+
+    std::sort(drift.begin(), drift.end());
+    state.counters["p50_ns"] = drift[drift.size() / 2];
+    state.counters["max_ns"] = drift.back();
+}
+BENCHMARK(BM_FastClockDrift)->Arg(1000)->Iterations(500)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,377 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/envelope.h"
+#include "mlafw/eventthread.h"
+#include "mlafw/objectpool.h"
+#include "mlafw/request.h"
+
+#include "blockingconcurrentqueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+// Count every heap allocation made by the process
+static std::atomic<std::int64_t> g_allocations{0};
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+constexpr int kBatchSize = 1000;
+const std::string kText(128, 'x');
+
+struct Stop {};
+
+struct Text {
+    std::string text;
+};
+
+using VariantEvent = std::variant<Stop, Text>;
+using EnvelopeEvent = mla::thread::Envelope<Stop, Text>;
+
+template <typename EventType>
+class Consumer
+    : public mla::thread::EventThread<Consumer<EventType>, EventType> {
+public:
+    void onEvent(const Stop&) {}
+
+    void onEvent(const Text& event) {
+        bytes += event.text.size();
+        processed.fetch_add(1, std::memory_order_release);
+    }
+
+    void waitFor(std::int64_t count) {
+        while (processed.load(std::memory_order_acquire) < count) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::size_t bytes = 0;
+    std::atomic<std::int64_t> processed{0};
+};
+
+template <typename EventType, typename MakeEvent>
+void runEventPath(benchmark::State& state, MakeEvent makeEvent) {
+    Consumer<EventType> consumer;
+    consumer.start();
+
+    std::int64_t sent = 0;
+    std::int64_t allocations = 0;
+    for (auto _ : state) {
+        const auto before = g_allocations.load(std::memory_order_relaxed);
+        for (int i = 0; i < kBatchSize; ++i) {
+            consumer.push(makeEvent());
+        }
+        sent += kBatchSize;
+        consumer.waitFor(sent);
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    }
+
+    consumer.exit();
+    consumer.join();
+
+    state.SetItemsProcessed(sent);
+    state.counters["allocs_per_event"] = benchmark::Counter(
+        static_cast<double>(allocations) / static_cast<double>(sent));
+}
+
+} // namespace
+
+// Producer builds a fresh std::string payload for every event
+static void BM_VariantEventPath(benchmark::State& state) {
+    runEventPath<VariantEvent>(state, [] { return VariantEvent{Text{kText}}; });
+}
+
+// The event path before lanes: one BlockingConcurrentQueue, which signals
+// and waits on its own semaphore. Compare with BM_VariantEventPath to see
+// what the lanes cost on the Default path.
+static void BM_BlockingQueuePath(benchmark::State& state) {
+    moodycamel::BlockingConcurrentQueue<VariantEvent> queue(
+        mla::thread::kDefaultQueueSize);
+    std::atomic<std::int64_t> processed{0};
+    std::size_t bytes = 0;
+    std::thread consumer([&] {
+        for (;;) {
+            VariantEvent event;
+            queue.wait_dequeue(event);
+            if (std::holds_alternative<Stop>(event)) {
+                break;
+            }
+            bytes += std::get<Text>(event).text.size();
+            processed.fetch_add(1, std::memory_order_release);
+        }
+    });
+
+    std::int64_t sent = 0;
+    std::int64_t allocations = 0;
+    for (auto _ : state) {
+        const auto before = g_allocations.load(std::memory_order_relaxed);
+        for (int i = 0; i < kBatchSize; ++i) {
+            queue.enqueue(VariantEvent{Text{kText}});
+        }
+        sent += kBatchSize;
+        while (processed.load(std::memory_order_acquire) < sent) {
+            std::this_thread::yield();
+        }
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    }
+
+    queue.enqueue(VariantEvent{Stop{}});
+    consumer.join();
+    benchmark::DoNotOptimize(bytes);
+
+    state.SetItemsProcessed(sent);
+    state.counters["allocs_per_event"] = benchmark::Counter(
+        static_cast<double>(allocations) / static_cast<double>(sent));
+}
+
+// Producer fills a recycled payload from its pool
+static void BM_EnvelopeEventPath(benchmark::State& state) {
+    mla::ObjectPool<Text> pool;
+    runEventPath<EnvelopeEvent>(state, [&pool] {
+        auto payload = pool.acquire();
+        payload->text.assign(kText);
+        return EnvelopeEvent{std::move(payload)};
+    });
+}
+
+namespace {
+
+// Ping-pong between two EventThreads with a payload of range(0) bytes
+struct Payload {
+    std::vector<char> data;
+};
+
+// Current style: the whole event, payload included, is copied each way
+class VariantClient;
+
+struct Ping {
+    Payload payload;
+    VariantClient* sender = nullptr;
+};
+
+struct Pong {
+    Payload payload;
+};
+
+class VariantServer
+    : public mla::thread::EventThread<VariantServer, std::variant<Stop, Ping>> {
+public:
+    void onEvent(const Stop&) {}
+    void onEvent(const Ping& event);
+};
+
+class VariantClient
+    : public mla::thread::EventThread<VariantClient, std::variant<Stop, Pong>> {
+public:
+    void onEvent(const Stop&) {}
+
+    void onEvent(const Pong&) {
+        replies.fetch_add(1, std::memory_order_release);
+    }
+
+    std::atomic<std::int64_t> replies{0};
+};
+
+void VariantServer::onEvent(const Ping& event) {
+    event.sender->push(Pong{event.payload});
+}
+
+// Request/reply: only a pool handle crosses the queues
+using ServerEvent = mla::thread::Envelope<Stop, mla::thread::Request<Payload>>;
+using ClientEvent = mla::thread::Envelope<Stop, mla::thread::Reply<Payload>>;
+
+class RequestServer
+    : public mla::thread::EventThread<RequestServer, ServerEvent> {
+public:
+    void onEvent(const Stop&) {}
+
+    void onEvent(mla::thread::Request<Payload>& request) {
+        std::move(request).reply();
+    }
+};
+
+class RequestClient
+    : public mla::thread::EventThread<RequestClient, ClientEvent> {
+public:
+    void onEvent(const Stop&) {}
+
+    void onEvent(const mla::thread::Reply<Payload>&) {
+        replies.fetch_add(1, std::memory_order_release);
+    }
+
+    std::atomic<std::int64_t> replies{0};
+};
+
+template <typename Client>
+void waitReplies(Client& client, std::int64_t count) {
+    while (client.replies.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+    }
+}
+
+// range(1) requests are kept in flight: 1 measures round-trip latency,
+// larger values measure throughput
+template <typename Server, typename Client, typename Send>
+void runPingPong(benchmark::State& state, Send send) {
+    const auto in_flight = state.range(1);
+    Server server;
+    Client client;
+    server.start();
+    client.start();
+
+    std::int64_t sent = 0;
+    std::int64_t allocations = 0;
+    for (auto _ : state) {
+        const auto before = g_allocations.load(std::memory_order_relaxed);
+        for (std::int64_t i = 0; i < in_flight; ++i) {
+            send(server, client);
+        }
+        sent += in_flight;
+        waitReplies(client, sent);
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    }
+
+    server.exit();
+    client.exit();
+    server.join();
+    client.join();
+
+    state.SetItemsProcessed(sent);
+    state.counters["allocs_per_roundtrip"] = benchmark::Counter(
+        static_cast<double>(allocations) / static_cast<double>(sent));
+}
+
+} // namespace
+
+static void BM_VariantPingPong(benchmark::State& state) {
+    const Payload payload{std::vector<char>(state.range(0), 'x')};
+    runPingPong<VariantServer, VariantClient>(
+        state, [&payload](VariantServer& server, VariantClient& client) {
+            server.push(Ping{payload, &client});
+        });
+}
+
+static void BM_RequestReplyPingPong(benchmark::State& state) {
+    const auto size = static_cast<std::size_t>(state.range(0));
+    mla::ObjectPool<Payload> pool;
+    runPingPong<RequestServer, RequestClient>(
+        state, [&pool, size](RequestServer& server, RequestClient& client) {
+            auto message = pool.acquire();
+            message->data.resize(size, 'x');
+            client.request(server, std::move(message));
+        });
+}
+
+namespace {
+
+// A control event pushed behind a backlog of data events, each taking
+// about a microsecond to handle
+constexpr int kBacklog = 10000;
+
+struct Work {};
+
+struct Control {
+    std::chrono::steady_clock::time_point sent;
+};
+
+class LaneConsumer
+    : public mla::thread::EventThread<LaneConsumer,
+                                      std::variant<Stop, Work, Control>> {
+public:
+    void onEvent(const Stop&) {}
+
+    void onEvent(const Work&) {
+        auto end = std::chrono::steady_clock::now() +
+                   std::chrono::microseconds(1);
+        while (std::chrono::steady_clock::now() < end) {
+        }
+        processed.fetch_add(1, std::memory_order_release);
+    }
+
+    void onEvent(const Control& event) {
+        latency = std::chrono::steady_clock::now() - event.sent;
+        controls.fetch_add(1, std::memory_order_release);
+    }
+
+    std::chrono::steady_clock::duration latency{};
+    std::atomic<std::int64_t> processed{0};
+    std::atomic<std::int64_t> controls{0};
+};
+
+} // namespace
+
+// Time from pushing a control event into a saturated queue until its
+// handler runs. range(0): 0 queues it behind the data in the Default lane,
+// 1 uses the Control lane with strict priority, 2 the Control lane with
+// weights {1, 8, 1}.
+static void BM_ControlLatency(benchmark::State& state) {
+    using mla::thread::Lane;
+    const auto mode = state.range(0);
+    LaneConsumer consumer;
+    if (mode == 2) {
+        consumer.setWeightedPriority({1, 8, 1});
+    }
+    consumer.start();
+
+    std::int64_t sent = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < kBacklog; ++i) {
+            consumer.push(Work{});
+        }
+        sent += kBacklog;
+
+        const auto controls = consumer.controls.load();
+        consumer.push(Control{std::chrono::steady_clock::now()},
+                      mode == 0 ? Lane::Default : Lane::Control);
+        while (consumer.controls.load(std::memory_order_acquire) ==
+               controls) {
+            std::this_thread::yield();
+        }
+        state.SetIterationTime(
+            std::chrono::duration<double>(consumer.latency).count());
+
+        while (consumer.processed.load(std::memory_order_acquire) < sent) {
+            std::this_thread::yield();
+        }
+    }
+
+    consumer.exit();
+    consumer.join();
+}
+
+BENCHMARK(BM_BlockingQueuePath)->UseRealTime();
+BENCHMARK(BM_VariantEventPath)->UseRealTime();
+BENCHMARK(BM_EnvelopeEventPath)->UseRealTime();
+BENCHMARK(BM_VariantPingPong)
+    ->ArgsProduct({{64, 4096}, {1, 256}})
+    ->UseRealTime();
+BENCHMARK(BM_RequestReplyPingPong)
+    ->ArgsProduct({{64, 4096}, {1, 256}})
+    ->UseRealTime();
+BENCHMARK(BM_ControlLatency)
+    ->DenseRange(0, 2)
+    ->Iterations(50)
+    ->UseManualTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/common.h"
+
+#include <atomic>
+#include <cstdint>
+
+// What Id::getId() used to do: one shared counter for every id
+static void BM_IdSharedCounter(benchmark::State& state) {
+    static std::atomic<std::uint64_t> counter{0};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            counter.fetch_add(1, std::memory_order_relaxed));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IdSharedCounter)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_IdBlocks(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mla::Id::getId());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IdBlocks)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_IdRouted(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mla::Id::getRoutedId(1));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IdRouted)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
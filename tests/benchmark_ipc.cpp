@@ -0,0 +1,185 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/ipc.h"
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+using mla::ipc::SharedRing;
+
+namespace {
+
+constexpr std::size_t kMessageSize = 64;
+
+using Payload = std::array<std::byte, kMessageSize>;
+
+bool writeAll(int fd, const std::byte* data, std::size_t size) {
+    while (size > 0) {
+        auto written = ::write(fd, data, size);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool readAll(int fd, std::byte* data, std::size_t size) {
+    while (size > 0) {
+        auto bytes = ::read(fd, data, size);
+        if (bytes <= 0) {
+            return false;
+        }
+        data += bytes;
+        size -= bytes;
+    }
+    return true;
+}
+
+// Next message of ring, sleeping until there is one; returns its size
+std::size_t receive(SharedRing& ring) {
+    std::size_t size = 0;
+    while (!ring.tryPop([&size](std::span<const std::byte> in) {
+        size = in.size();
+    })) {
+        ring.wait();
+    }
+    return size;
+}
+
+void send(SharedRing& ring, std::span<const std::byte> message) {
+    ring.push([message](std::span<std::byte> out) {
+        std::copy(message.begin(), message.end(), out.begin());
+        return message.size();
+    });
+}
+
+// An empty message ends the other process
+template <typename Child>
+pid_t spawn(Child child) {
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        child();
+        ::_exit(0);
+    }
+    return pid;
+}
+
+} // namespace
+
+// Round trip of a message to another process and back, over a ring each way
+static void BM_RingPingPong(benchmark::State& state) {
+    auto requests = SharedRing::anonymous(64, kMessageSize);
+    auto replies = SharedRing::anonymous(64, kMessageSize);
+
+    pid_t child = spawn([&] {
+        Payload reply{};
+        while (receive(requests) > 0) {
+            send(replies, reply);
+        }
+    });
+
+    Payload request{};
+    for (auto _ : state) {
+        send(requests, request);
+        receive(replies);
+    }
+    send(requests, {});
+    ::waitpid(child, nullptr, 0);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingPingPong)->UseRealTime();
+
+static void BM_SocketPingPong(benchmark::State& state) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+
+    pid_t child = spawn([&] {
+        ::close(fds[0]);
+        Payload message;
+        while (readAll(fds[1], message.data(), message.size()) &&
+               writeAll(fds[1], message.data(), message.size())) {
+        }
+    });
+    ::close(fds[1]);
+
+    Payload message{};
+    for (auto _ : state) {
+        if (!writeAll(fds[0], message.data(), message.size()) ||
+            !readAll(fds[0], message.data(), message.size())) {
+            state.SkipWithError("Echo failed");
+            break;
+        }
+    }
+    ::close(fds[0]);
+    ::waitpid(child, nullptr, 0);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SocketPingPong)->UseRealTime();
+
+// One-way stream of messages to another process, which acknowledges the
+// end of it
+static void BM_RingThroughput(benchmark::State& state) {
+    auto requests = SharedRing::anonymous(state.range(0), kMessageSize);
+    auto replies = SharedRing::anonymous(2, kMessageSize);
+
+    pid_t child = spawn([&] {
+        while (receive(requests) > 0) {
+        }
+        Payload done{};
+        send(replies, done);
+    });
+
+    Payload message{};
+    for (auto _ : state) {
+        send(requests, message);
+    }
+    send(requests, {});
+    receive(replies);
+    ::waitpid(child, nullptr, 0);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * kMessageSize);
+}
+BENCHMARK(BM_RingThroughput)->Arg(256)->Arg(4096)->UseRealTime();
+
+static void BM_SocketThroughput(benchmark::State& state) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+
+    pid_t child = spawn([&] {
+        ::close(fds[0]);
+        Payload message;
+        while (readAll(fds[1], message.data(), message.size())) {
+        }
+        writeAll(fds[1], message.data(), 1);
+    });
+
+    Payload message{};
+    for (auto _ : state) {
+        if (!writeAll(fds[0], message.data(), message.size())) {
+            state.SkipWithError("write failed");
+            break;
+        }
+    }
+    ::shutdown(fds[0], SHUT_WR);
+    readAll(fds[0], message.data(), 1);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    ::waitpid(child, nullptr, 0);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * kMessageSize);
+}
+BENCHMARK(BM_SocketThroughput)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -1,6 +1,10 @@
 #include <benchmark/benchmark.h>
 #include "mlafw/vectorquickmap.h"
 #include "mlafw/arrayquickmap.h"
+#include "mlafw/mappedquickmap.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
 #include <random>
 #include <string>
 #include <unordered_map>
@@ -85,9 +89,122 @@ static void BM_UnorderedMap(benchmark::State& state) {
     }
 }
 
+// Cold start: rebuild a map by re-inserting every entry, then look them up
+static void BM_VectorQuickMapRebuild(benchmark::State& state) {
+    const std::int64_t num_entries = state.range(0);
+
+    for (auto _ : state) {
+        VectorQuickMap<std::int64_t, std::int64_t> map;
+        for (std::int64_t i = 0; i < num_entries; ++i) {
+            map.insert(i, i);
+        }
+        for (std::int64_t i = 0; i < num_entries; ++i) {
+            benchmark::DoNotOptimize(map.get(i));
+        }
+    }
+}
+
+static std::string snapshot_path(std::int64_t num_entries) {
+    return (std::filesystem::temp_directory_path() /
+            ("mlafw_bench_snapshot_" + std::to_string(num_entries) + ".bin"))
+        .string();
+}
+
+static void BM_VectorQuickMapDump(benchmark::State& state) {
+    const std::int64_t num_entries = state.range(0);
+    VectorQuickMap<std::int64_t, std::int64_t> map;
+    for (std::int64_t i = 0; i < num_entries; ++i) {
+        map.insert(i, i);
+    }
+
+    const auto path = snapshot_path(num_entries);
+    for (auto _ : state) {
+        map.dump(path);
+    }
+    std::filesystem::remove(path);
+}
+
+// Cold start: map a previously dumped snapshot, then look every entry up
+static void BM_MappedQuickMapLoad(benchmark::State& state) {
+    const std::int64_t num_entries = state.range(0);
+    const auto path = snapshot_path(num_entries);
+    {
+        VectorQuickMap<std::int64_t, std::int64_t> map;
+        for (std::int64_t i = 0; i < num_entries; ++i) {
+            map.insert(i, i);
+        }
+        map.dump(path);
+    }
+
+    for (auto _ : state) {
+        MappedQuickMap<std::int64_t, std::int64_t> map(path);
+        for (std::int64_t i = 0; i < num_entries; ++i) {
+            benchmark::DoNotOptimize(map.get(i));
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+// Build a map of 1M slots filled to fill_percent. Entries are inserted up to
+// the max load first and then removed, as happens after deletions. Keys are
+// scattered so that std::hash does not put them in one long cluster.
+static VectorQuickMap<std::int64_t, std::int64_t> sparse_map(int fill_percent) {
+    constexpr std::int64_t capacity = 1 << 20;
+    constexpr std::int64_t max_entries = capacity * 7 / 10;
+    auto key = [](std::int64_t i) {
+        return static_cast<std::int64_t>(i * 0x9E3779B97F4A7C15ull >> 1);
+    };
+
+    VectorQuickMap<std::int64_t, std::int64_t> map(capacity);
+    for (std::int64_t i = 0; i < max_entries; ++i) {
+        map.insert(key(i), i);
+    }
+    const std::int64_t keep = capacity * fill_percent / 100;
+    for (std::int64_t i = keep; i < max_entries; ++i) {
+        map.remove(key(i));
+    }
+    return map;
+}
+
+static void BM_VectorQuickMapIterate(benchmark::State& state) {
+    auto map = sparse_map(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        std::int64_t sum = 0;
+        for (const auto& pair : map) {
+            sum += pair.second;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+}
+
+static void BM_VectorQuickMapForEach(benchmark::State& state) {
+    auto map = sparse_map(static_cast<int>(state.range(0)));
+    const auto num_threads = static_cast<unsigned>(state.range(1));
+
+    for (auto _ : state) {
+        std::atomic<std::int64_t> sum{0};
+        map.for_each(
+            [&sum](const std::int64_t&, std::int64_t& value) {
+                sum.fetch_add(value, std::memory_order_relaxed);
+            },
+            num_threads);
+        benchmark::DoNotOptimize(sum.load());
+    }
+    state.SetItemsProcessed(state.iterations() * map.size());
+}
+
 // Register benchmarks
 BENCHMARK(BM_VectorQuickMap)->Range(8, 4096);
 BENCHMARK(BM_ArrayQuickMap<6191>)->Range(8, 4096);
 BENCHMARK(BM_UnorderedMap)->Range(8, 4096);
+BENCHMARK(BM_VectorQuickMapRebuild)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_VectorQuickMapDump)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_MappedQuickMapLoad)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_VectorQuickMapIterate)->Arg(1)->Arg(10)->Arg(25)->Arg(50)->Arg(70);
+BENCHMARK(BM_VectorQuickMapForEach)
+    ->ArgsProduct({{1, 10, 25, 50, 70}, {1, 4}})
+    ->UseRealTime();
 
 BENCHMARK_MAIN();
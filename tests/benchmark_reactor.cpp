@@ -0,0 +1,151 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/eventthread.h"
+#include "mlafw/reactor.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstddef>
+#include <thread>
+#include <variant>
+
+namespace {
+
+constexpr std::size_t kMaxMessage = 4096;
+
+struct Message {
+    std::array<char, kMaxMessage> data;
+    std::size_t size;
+};
+
+using Event = std::variant<std::monostate, Message>;
+
+void writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        auto written = ::write(fd, data, size);
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// Echo everything the client sends from the thread that reads it
+class EchoReactor
+    : public mla::thread::ReactorThread<EchoReactor, Event> {
+public:
+    explicit EchoReactor(int fd) : fd(fd) { add(fd); }
+
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const Message& message) {
+        writeAll(fd, message.data.data(), message.size);
+    }
+
+    void onEvent(const mla::thread::IoReady&) {
+        Message message;
+        auto size = ::read(fd, message.data.data(), message.data.size());
+        if (size > 0) {
+            message.size = size;
+            onEvent(message);
+        }
+    }
+
+private:
+    int fd;
+};
+
+// The same with a reader thread blocking in read() and pushing what it
+// reads to an EventThread, the design without a reactor
+class EchoThread : public mla::thread::EventThread<EchoThread, Event> {
+public:
+    explicit EchoThread(int fd) : fd(fd) {}
+
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const Message& message) {
+        writeAll(fd, message.data.data(), message.size);
+    }
+
+    // Returns once the client has closed its end
+    void readLoop() {
+        Message message;
+        ssize_t size;
+        while ((size = ::read(fd, message.data.data(),
+                              message.data.size())) > 0) {
+            message.size = size;
+            push(message);
+        }
+    }
+
+private:
+    int fd;
+};
+
+void roundTrips(benchmark::State& state, int client) {
+    const auto size = static_cast<std::size_t>(state.range(0));
+    std::array<char, kMaxMessage> request{};
+    std::array<char, kMaxMessage> reply;
+
+    for (auto _ : state) {
+        writeAll(client, request.data(), size);
+        std::size_t received = 0;
+        while (received < size) {
+            auto bytes = ::read(client, reply.data() + received,
+                                size - received);
+            if (bytes <= 0) {
+                state.SkipWithError("Echo failed");
+                return;
+            }
+            received += bytes;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+} // namespace
+
+static void BM_EchoReactor(benchmark::State& state) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+
+    EchoReactor reactor(fds[1]);
+    reactor.start();
+    roundTrips(state, fds[0]);
+    reactor.exit();
+    reactor.join();
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+BENCHMARK(BM_EchoReactor)->Arg(64)->Arg(4096)->UseRealTime();
+
+static void BM_EchoReaderThread(benchmark::State& state) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+
+    EchoThread echo(fds[1]);
+    echo.start();
+    std::thread reader([&echo] { echo.readLoop(); });
+    roundTrips(state, fds[0]);
+
+    ::shutdown(fds[0], SHUT_WR);
+    reader.join();
+    echo.exit();
+    echo.join();
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+BENCHMARK(BM_EchoReaderThread)->Arg(64)->Arg(4096)->UseRealTime();
+
+BENCHMARK_MAIN();
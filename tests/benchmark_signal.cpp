@@ -0,0 +1,131 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/eventthread.h"
+#include "mlafw/signal.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace {
+
+struct Quote {
+    std::string symbol;
+    double price = 0.0;
+};
+
+const Quote kQuote{std::string(64, 'x'), 1.0};
+
+struct Stop {};
+
+using SharedEvent = std::variant<Stop, mla::signal::Shared<Quote>>;
+using CopyEvent = std::variant<Stop, Quote>;
+
+template <typename EventType>
+class Subscriber
+    : public mla::thread::EventThread<Subscriber<EventType>, EventType> {
+public:
+    void onEvent(const Stop&) {}
+
+    void onEvent(const mla::signal::Shared<Quote>& quote) {
+        sum += quote->price;
+        processed.fetch_add(1, std::memory_order_release);
+    }
+
+    void onEvent(const Quote& quote) {
+        sum += quote.price;
+        processed.fetch_add(1, std::memory_order_release);
+    }
+
+    void waitFor(std::int64_t count) {
+        while (processed.load(std::memory_order_acquire) < count) {
+            std::this_thread::yield();
+        }
+    }
+
+    double sum = 0.0;
+    std::atomic<std::int64_t> processed{0};
+};
+
+template <typename EventType>
+struct Subscribers {
+    explicit Subscribers(std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            threads.push_back(std::make_unique<Subscriber<EventType>>());
+            threads.back()->start();
+        }
+    }
+
+    ~Subscribers() {
+        for (auto& thread : threads) {
+            thread->exit();
+            thread->join();
+        }
+    }
+
+    void waitFor(std::int64_t count) {
+        for (auto& thread : threads) {
+            thread->waitFor(count);
+        }
+    }
+
+    std::vector<std::unique_ptr<Subscriber<EventType>>> threads;
+};
+
+} // namespace
+
+// Direct slots only: emit cost is the subscriber list walk
+static void BM_SignalEmitDirect(benchmark::State& state) {
+    mla::signal::Signal<Quote> signal;
+    double sum = 0.0;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        signal.connect([&sum](const Quote& quote) { sum += quote.price; });
+    }
+
+    for (auto _ : state) {
+        signal.emit(kQuote);
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SignalEmitDirect)->Arg(1)->Arg(10)->Arg(100);
+
+// Queued to range(0) EventThreads through the signal: one shared payload
+// per emit, however many subscribers there are
+static void BM_SignalEmitQueued(benchmark::State& state) {
+    Subscribers<SharedEvent> subscribers(state.range(0));
+    mla::signal::Signal<Quote> signal;
+    for (auto& thread : subscribers.threads) {
+        signal.connect(*thread);
+    }
+
+    std::int64_t emitted = 0;
+    for (auto _ : state) {
+        signal.emit(kQuote);
+        ++emitted;
+    }
+    subscribers.waitFor(emitted);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SignalEmitQueued)->Arg(1)->Arg(10)->Arg(100)->UseRealTime();
+
+// Baseline: loop over the targets and push a copy of the event to each
+static void BM_PushCopyToEach(benchmark::State& state) {
+    Subscribers<CopyEvent> subscribers(state.range(0));
+
+    std::int64_t emitted = 0;
+    for (auto _ : state) {
+        for (auto& thread : subscribers.threads) {
+            thread->push(CopyEvent{kQuote});
+        }
+        ++emitted;
+    }
+    subscribers.waitFor(emitted);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PushCopyToEach)->Arg(1)->Arg(10)->Arg(100)->UseRealTime();
+
+BENCHMARK_MAIN();
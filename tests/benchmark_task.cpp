@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/eventthread.h"
+#include "mlafw/task.h"
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <thread>
+#include <variant>
+
+namespace {
+
+struct Stop {};
+
+// One step of a multi-step interaction
+struct Step {};
+
+using Event = std::variant<Stop, Step, mla::thread::Resume>;
+
+// Hand-written state machine advanced by Step events
+class StateMachine : public mla::thread::EventThread<StateMachine, Event> {
+public:
+    void onEvent(const Stop&) {}
+
+    void onEvent(const Step&) {
+        switch (state) {
+        case 0:
+            state = 1;
+            break;
+        case 1:
+            state = 2;
+            break;
+        default:
+            state = 0;
+            ++rounds;
+            break;
+        }
+    }
+
+    int state = 0;
+    std::int64_t rounds = 0;
+};
+
+// Awaiter that parks the coroutine until somebody resumes it
+struct Park {
+    std::coroutine_handle<>& parked;
+
+    bool await_ready() noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) noexcept {
+        parked = handle;
+    }
+    void await_resume() noexcept {}
+};
+
+class CoroutineThread
+    : public mla::thread::EventThread<CoroutineThread, Event> {
+public:
+    void onEvent(const Stop&) {}
+    void onEvent(const Step&) {}
+
+    std::coroutine_handle<> parked;
+    std::int64_t rounds = 0;
+};
+
+mla::task<> stepsAsCoroutine(CoroutineThread& thread) {
+    while (true) {
+        co_await Park{thread.parked};
+        co_await Park{thread.parked};
+        co_await Park{thread.parked};
+        ++thread.rounds;
+    }
+}
+
+mla::task<int> child(int value) {
+    co_return value + 1;
+}
+
+mla::task<int> parent(int value) {
+    co_return co_await child(value);
+}
+
+} // namespace
+
+// Each step is one event dispatched to a state machine handler
+static void BM_StateMachineStep(benchmark::State& state) {
+    StateMachine machine;
+    Event event{Step{}};
+    for (auto _ : state) {
+        machine.processEvent(event);
+    }
+    benchmark::DoNotOptimize(machine.rounds);
+}
+
+// Each step is one Resume event dispatched to a suspended coroutine
+static void BM_CoroutineResumeStep(benchmark::State& state) {
+    CoroutineThread thread;
+    auto task = stepsAsCoroutine(thread);
+    auto handle = task.release();
+    handle.resume();
+
+    for (auto _ : state) {
+        Event event{mla::thread::Resume{thread.parked}};
+        thread.processEvent(event);
+    }
+    benchmark::DoNotOptimize(thread.rounds);
+    handle.destroy();
+}
+
+// Create, run and destroy a task awaiting a child task, which exercises
+// the per-thread frame allocator
+static void BM_TaskCreateAndAwait(benchmark::State& state) {
+    for (auto _ : state) {
+        auto task = parent(1);
+        auto handle = task.release();
+        handle.resume();
+        benchmark::DoNotOptimize(handle.promise().value);
+        handle.destroy();
+    }
+}
+
+BENCHMARK(BM_StateMachineStep);
+BENCHMARK(BM_CoroutineResumeStep);
+BENCHMARK(BM_TaskCreateAndAwait);
+
+BENCHMARK_MAIN();
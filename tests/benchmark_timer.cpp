@@ -0,0 +1,251 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/shardedtimer.h"
+#include "mlafw/timer.h"
+#include "mlafw/timerfd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using mla::timer::clock_type;
+
+struct LatenessReceiver : mla::timer::Receiver {
+    void timeout(mla::timer::timer_id) override {
+        firedAt = clock_type::now();
+        fired.store(true, std::memory_order_release);
+    }
+
+    clock_type::time_point firedAt;
+    std::atomic<bool> fired{false};
+};
+
+struct NullReceiver : mla::timer::Receiver {
+    void timeout(mla::timer::timer_id) override {}
+};
+
+// Counts how often producers wake up the timer thread
+struct CountingBackend : mla::timer::CondVarBackend {
+    void notify() {
+        notified.fetch_add(1, std::memory_order_relaxed);
+        mla::timer::CondVarBackend::notify();
+    }
+
+    std::atomic<std::int64_t> notified{0};
+};
+
+// Receiver recovering each timer's context by id, as receivers serving
+// many timers do
+struct LookupReceiver : mla::timer::Receiver {
+    void timeout(mla::timer::timer_id id) override {
+        auto it = contexts.find(id);
+        sum += it->second;
+        contexts.erase(it);
+    }
+
+    std::unordered_map<mla::timer::timer_id, std::int64_t> contexts;
+    std::int64_t sum = 0;
+};
+
+double percentile(std::vector<double>& samples, double q) {
+    std::sort(samples.begin(), samples.end());
+    auto index = static_cast<std::size_t>(q * (samples.size() - 1));
+    return samples[index];
+}
+
+} // namespace
+
+// Order one timer range(0) microseconds ahead at a time and record how late
+// it fires, in microseconds
+template <typename TimerType>
+static void BM_TimerLateness(benchmark::State& state) {
+    TimerType timer;
+    timer.start();
+
+    const std::chrono::microseconds timeout(state.range(0));
+    std::vector<double> lateness;
+    lateness.reserve(state.max_iterations);
+
+    for (auto _ : state) {
+        LatenessReceiver receiver;
+        auto expiry = clock_type::now() + timeout;
+        timer.order(&receiver, timeout);
+        while (!receiver.fired.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        lateness.push_back(
+            std::chrono::duration<double, std::micro>(receiver.firedAt -
+                                                      expiry)
+                .count());
+    }
+
+    timer.exit();
+    timer.join();
+
+    state.counters["p50_us"] = percentile(lateness, 0.50);
+    state.counters["p99_us"] = percentile(lateness, 0.99);
+    state.counters["max_us"] = lateness.back();
+}
+BENCHMARK_TEMPLATE(BM_TimerLateness, mla::timer::Timer)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Iterations(2000)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TimerLateness, mla::timer::FdTimer)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Iterations(2000)
+    ->UseRealTime();
+
+// Reschedule one of range(0) pending timers by cancelling and ordering it
+// again, as receivers had to before rearm()
+static void BM_TimerCancelOrder(benchmark::State& state) {
+    // Commands are applied by the timer thread
+    mla::timer::Timer timer;
+    timer.start();
+    NullReceiver receiver;
+    std::vector<mla::timer::timer_id> ids;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        ids.push_back(timer.order(&receiver, std::chrono::hours(1) +
+                                                 std::chrono::seconds(i)));
+    }
+
+    std::size_t next = 0;
+    for (auto _ : state) {
+        auto& id = ids[next++ % ids.size()];
+        timer.cancel(id);
+        id = timer.order(&receiver, std::chrono::hours(2));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    timer.exit();
+    timer.join();
+}
+BENCHMARK(BM_TimerCancelOrder)->Arg(100)->Arg(10000);
+
+// The same with an in-place rearm()
+static void BM_TimerRearm(benchmark::State& state) {
+    mla::timer::Timer timer;
+    timer.start();
+    NullReceiver receiver;
+    std::vector<mla::timer::timer_id> ids;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        ids.push_back(timer.order(&receiver, std::chrono::hours(1) +
+                                                 std::chrono::seconds(i)));
+    }
+
+    std::size_t next = 0;
+    for (auto _ : state) {
+        timer.rearm(ids[next++ % ids.size()], std::chrono::hours(2));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    timer.exit();
+    timer.join();
+}
+BENCHMARK(BM_TimerRearm)->Arg(100)->Arg(10000);
+
+// Every benchmark thread arms a timer and cancels it again. All threads
+// share one Timer, or one ShardedTimer with a shard per thread.
+template <typename TimerType>
+static void BM_TimerArmCancel(benchmark::State& state) {
+    static std::unique_ptr<TimerType> timer;
+    if (state.thread_index() == 0) {
+        if constexpr (std::is_same_v<TimerType, mla::timer::ShardedTimer>) {
+            timer = std::make_unique<TimerType>(state.threads());
+        } else {
+            timer = std::make_unique<TimerType>();
+        }
+        timer->start();
+    }
+    if constexpr (std::is_same_v<TimerType, mla::timer::ShardedTimer>) {
+        TimerType::bindCurrentThread(state.thread_index());
+    }
+
+    NullReceiver receiver;
+    for (auto _ : state) {
+        auto id = timer->order(&receiver, std::chrono::seconds(1));
+        benchmark::DoNotOptimize(timer->cancel(id));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        timer->exit();
+        timer->join();
+        timer.reset();
+    }
+}
+BENCHMARK_TEMPLATE(BM_TimerArmCancel, mla::timer::Timer)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TimerArmCancel, mla::timer::ShardedTimer)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+// Order timers behind one pending timer that expires first, as most timers
+// of a busy service do. Only orders earlier than the timer thread's next
+// deadline have to wake it up; wakeups_per_order should stay near zero.
+static void BM_TimerOrderBehindDeadline(benchmark::State& state) {
+    mla::timer::BasicTimer<CountingBackend> timer;
+    timer.start();
+
+    NullReceiver receiver;
+    auto first = timer.order(&receiver, std::chrono::minutes(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    auto before = timer.backend().notified.load();
+
+    for (auto _ : state) {
+        auto id = timer.order(&receiver, std::chrono::minutes(2));
+        benchmark::DoNotOptimize(timer.cancel(id));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["wakeups_per_order"] =
+        static_cast<double>(timer.backend().notified.load() - before) /
+        static_cast<double>(state.iterations());
+
+    timer.cancel(first);
+    timer.exit();
+    timer.join();
+}
+BENCHMARK(BM_TimerOrderBehindDeadline)->UseRealTime();
+
+// Order and fire range(0) timers that each carry some context, looked up
+// by id in a Receiver or captured by a callable
+static void BM_TimerDispatchReceiver(benchmark::State& state) {
+    mla::timer::Timer timer;
+    LookupReceiver receiver;
+    for (auto _ : state) {
+        for (std::int64_t i = 0; i < state.range(0); ++i) {
+            auto id = timer.order(&receiver, mla::timer::duration::zero());
+            receiver.contexts.emplace(id, i);
+        }
+        timer.poll();
+    }
+    benchmark::DoNotOptimize(receiver.sum);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TimerDispatchReceiver)->Arg(1000);
+
+static void BM_TimerDispatchCallable(benchmark::State& state) {
+    mla::timer::Timer timer;
+    std::int64_t sum = 0;
+    for (auto _ : state) {
+        for (std::int64_t i = 0; i < state.range(0); ++i) {
+            timer.order([&sum, i](mla::timer::timer_id) { sum += i; },
+                        mla::timer::duration::zero());
+        }
+        timer.poll();
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TimerDispatchCallable)->Arg(1000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include "mlafw/uring.h"
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kBlockSize = 4096;
+// Writes wrap around within this much of the file
+constexpr std::uint64_t kFileSize = 64 << 20;
+
+struct TempFile {
+    TempFile() { fd = ::mkstemp(path); }
+    ~TempFile() {
+        ::close(fd);
+        ::unlink(path);
+    }
+
+    char path[32] = "/tmp/benchuringXXXXXX";
+    int fd;
+};
+
+struct Counter {
+    static void complete(void* self, std::uint64_t, int) {
+        auto& count = static_cast<Counter*>(self)->count;
+        count.fetch_add(1, std::memory_order_release);
+        count.notify_one();
+    }
+
+    void waitFor(std::int64_t target) {
+        std::int64_t current;
+        while ((current = count.load(std::memory_order_acquire)) < target) {
+            count.wait(current);
+        }
+    }
+
+    std::atomic<std::int64_t> count{0};
+};
+
+} // namespace
+
+// Write range(0) blocks per iteration with pwrite(), as an EventThread
+// persisting its state does today
+static void BM_FileWriteSync(benchmark::State& state) {
+    TempFile file;
+    std::vector<std::byte> block(kBlockSize, std::byte{1});
+    std::uint64_t offset = 0;
+    for (auto _ : state) {
+        for (std::int64_t i = 0; i < state.range(0); ++i) {
+            benchmark::DoNotOptimize(
+                ::pwrite(file.fd, block.data(), block.size(), offset));
+            offset = (offset + kBlockSize) % kFileSize;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * kBlockSize);
+}
+BENCHMARK(BM_FileWriteSync)->Arg(1)->Arg(32)->UseRealTime();
+
+// The same through an IoService, submitted in one batch and waited for.
+// CPU time is what the submitting thread spends.
+template <bool Fixed>
+static void BM_FileWriteUring(benchmark::State& state) {
+    if (!mla::io::IoService::supported()) {
+        state.SkipWithError("io_uring is not available");
+        return;
+    }
+
+    TempFile file;
+    std::vector<std::byte> block(kBlockSize, std::byte{1});
+    mla::io::IoService service;
+    if constexpr (Fixed) {
+        iovec buffers[] = {{block.data(), block.size()}};
+        service.registerBuffers(buffers);
+    }
+    service.start();
+
+    Counter counter;
+    const mla::io::Completion done{&counter, &Counter::complete};
+    std::uint64_t offset = 0;
+    std::int64_t submitted = 0;
+    for (auto _ : state) {
+        {
+            mla::io::IoService::Batch batch(service);
+            for (std::int64_t i = 0; i < state.range(0); ++i) {
+                if constexpr (Fixed) {
+                    service.writeFixed(file.fd, 0, block, offset, done);
+                } else {
+                    service.write(file.fd, block, offset, done);
+                }
+                offset = (offset + kBlockSize) % kFileSize;
+            }
+        }
+        submitted += state.range(0);
+        counter.waitFor(submitted);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * kBlockSize);
+
+    service.exit();
+    service.join();
+}
+BENCHMARK_TEMPLATE(BM_FileWriteUring, false)->Arg(1)->Arg(32)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_FileWriteUring, true)->Arg(1)->Arg(32)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include "mlafw/clock.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using mla::clock::FastClock;
+
+TEST(ClockTests, Monotonic)
+{
+    auto previous = FastClock::now();
+    for(int i = 0; i < 1000000; ++i)
+    {
+        auto now = FastClock::now();
+        ASSERT_GE(now, previous);
+        previous = now;
+    }
+}
+
+TEST(ClockTests, MonotonicAcrossRecalibration)
+{
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 2; ++i)
+    {
+        threads.emplace_back(
+            []
+            {
+                auto end = std::chrono::steady_clock::now() +
+                           2 * FastClock::kRecalibrationInterval;
+                auto previous = FastClock::now();
+                while(std::chrono::steady_clock::now() < end)
+                {
+                    auto now = FastClock::now();
+                    ASSERT_GE(now, previous);
+                    previous = now;
+                }
+            });
+    }
+    for(auto& thread : threads)
+        thread.join();
+}
+
+TEST(ClockTests, FollowsSteadyClock)
+{
+    for(int i = 0; i < 3; ++i)
+    {
+        std::this_thread::sleep_for(FastClock::kRecalibrationInterval / 2);
+        auto before = std::chrono::steady_clock::now();
+        auto now = FastClock::now();
+        auto after = std::chrono::steady_clock::now();
+        EXPECT_GT(now, before - 100us);
+        EXPECT_LT(now, after + 100us);
+    }
+}
+
+TEST(ClockTests, FollowsSteadyClockAfterIdleGap)
+{
+    auto usingTsc = FastClock::usingTsc();
+    for(int i = 0; i < 2; ++i)
+    {
+        auto previous = FastClock::now();
+        std::this_thread::sleep_for(5 * FastClock::kRecalibrationInterval);
+        auto before = std::chrono::steady_clock::now();
+        auto now = FastClock::now();
+        auto after = std::chrono::steady_clock::now();
+        EXPECT_GE(now, previous);
+        EXPECT_GT(now, before - 100us);
+        EXPECT_LT(now, after + 100us);
+        EXPECT_EQ(FastClock::usingTsc(), usingTsc);
+    }
+}
+
+TEST(ClockTests, WallTime)
+{
+    auto before = std::chrono::system_clock::now();
+    auto wall = FastClock::wallNow();
+    auto after = std::chrono::system_clock::now();
+    EXPECT_GT(wall, before - 1ms);
+    EXPECT_LT(wall, after + 1ms);
+
+    auto now = FastClock::now();
+    auto elapsed = FastClock::toWall(now + 1s) - FastClock::toWall(now);
+    EXPECT_GT(elapsed, 1s - 10us);
+    EXPECT_LT(elapsed, 1s + 10us);
+}
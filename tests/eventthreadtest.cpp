@@ -6,6 +6,8 @@
 #include <barrier>
 #include <chrono>
 #include <random>
+#include <stdexcept>
+#include <type_traits>
 #include <variant>
 #include <vector>
 
@@ -276,3 +278,317 @@ TEST(EventThreadTest, InterThreadCommunication)
     LOG_INFO(StdLogger(), "SomeEvents: {}", someEventCounter.load());
     LOG_INFO(StdLogger(), "SomeOtherEvents: {}", someOtherEventCounter.load());
 }
+
+struct SmallPayload
+{
+    int value;
+};
+
+struct LargePayload
+{
+    std::string text;
+    std::vector<int> values;
+};
+
+using EnvelopeEvent =
+    mla::thread::Envelope<SmallPayload, LargePayload, BreakEventLoop>;
+
+static_assert(sizeof(EnvelopeEvent) <= mla::thread::kEnvelopeInlineSize + 8);
+
+class EnvelopeEventThread
+    : public mla::thread::EventThread<EnvelopeEventThread, EnvelopeEvent>
+{
+public:
+    void onEvent(const SmallPayload& event)
+    {
+        smallSum += event.value;
+    }
+
+    void onEvent(const LargePayload& event)
+    {
+        largeSum += static_cast<int>(event.text.size() + event.values.size());
+    }
+
+    void onEvent(const BreakEventLoop&)
+    {
+        breakEventLoop();
+    }
+
+    int smallSum = 0;
+    int largeSum = 0;
+};
+
+TEST(EventThreadTest, ObjectPoolRecyclesObjects)
+{
+    mla::ObjectPool<std::string> pool;
+    const std::string* first = nullptr;
+    {
+        auto handle = pool.acquire();
+        handle->assign(100, 'x');
+        first = handle.get();
+    }
+
+    // The released object is handed out again with its capacity intact
+    auto handle = pool.acquire();
+    EXPECT_EQ(handle.get(), first);
+    EXPECT_GE(handle->capacity(), 100);
+    EXPECT_EQ(pool.capacity(), 1);
+
+    auto other = pool.acquire();
+    EXPECT_NE(other.get(), first);
+    EXPECT_EQ(pool.capacity(), 2);
+}
+
+TEST(EventThreadTest, EnvelopeHoldsInlineAndPooledPayloads)
+{
+    mla::ObjectPool<LargePayload> pool;
+
+    EnvelopeEvent empty;
+    EXPECT_TRUE(empty.empty());
+
+    EnvelopeEvent small{SmallPayload{7}};
+    ASSERT_TRUE(small.holds<SmallPayload>());
+    EXPECT_EQ(small.get_if<SmallPayload>()->value, 7);
+    EXPECT_EQ(small.get_if<LargePayload>(), nullptr);
+
+    auto payload = pool.acquire();
+    payload->text = "hello";
+    EnvelopeEvent large{std::move(payload)};
+    EnvelopeEvent moved{std::move(large)};
+    EXPECT_TRUE(large.empty());
+    ASSERT_TRUE(moved.holds<LargePayload>());
+    EXPECT_EQ(moved.get_if<LargePayload>()->text, "hello");
+
+    // A const envelope hands out const payloads only, pooled ones included
+    const EnvelopeEvent& constant = moved;
+    constant.visit(
+        [](auto& value)
+        {
+            static_assert(
+                std::is_const_v<std::remove_reference_t<decltype(value)>>);
+        });
+    moved.visit(
+        [](auto& value)
+        {
+            static_assert(
+                !std::is_const_v<std::remove_reference_t<decltype(value)>>);
+        });
+
+    // Destroying the envelope gives the payload back to the pool
+    moved.reset();
+    EXPECT_EQ(pool.acquire()->text, "hello");
+    EXPECT_EQ(pool.capacity(), 1);
+}
+
+TEST(EventThreadTest, EnvelopeDispatch)
+{
+    constexpr int NUM_EVENTS = 1000;
+
+    mla::ObjectPool<LargePayload> pool;
+    EnvelopeEventThread th;
+    th.start();
+
+    for(int i = 0; i < NUM_EVENTS; ++i)
+    {
+        th.push(EnvelopeEvent{SmallPayload{1}});
+
+        auto payload = pool.acquire();
+        payload->text.assign(3, 'a');
+        payload->values.assign(2, i);
+        th.push(EnvelopeEvent{std::move(payload)});
+    }
+    th.push(EnvelopeEvent{BreakEventLoop{}});
+    th.join();
+
+    EXPECT_EQ(th.smallSum, NUM_EVENTS);
+    EXPECT_EQ(th.largeSum, NUM_EVENTS * 5);
+}
+
+struct Query
+{
+    int question = 0;
+    int answer = 0;
+    std::vector<int> history;
+};
+
+using ServerEvent =
+    mla::thread::Envelope<mla::thread::Request<Query>, BreakEventLoop>;
+using ClientEvent =
+    mla::thread::Envelope<mla::thread::Reply<Query>, BreakEventLoop>;
+
+class ServerThread : public mla::thread::EventThread<ServerThread, ServerEvent>
+{
+public:
+    void onEvent(mla::thread::Request<Query>& request)
+    {
+        request->answer = request->question * 2;
+        request->history.push_back(request->answer);
+        std::move(request).reply();
+    }
+
+    void onEvent(const BreakEventLoop&)
+    {
+        breakEventLoop();
+    }
+};
+
+class ClientThread : public mla::thread::EventThread<ClientThread, ClientEvent>
+{
+public:
+    void onEvent(mla::thread::Reply<Query>& reply)
+    {
+        {
+            // Back to the pool before the reply is counted, so the next
+            // request reuses it
+            auto message = std::move(reply).release();
+            answerSum += message->answer;
+            lastMessage = &*message;
+        }
+        replies++;
+    }
+
+    void onEvent(const BreakEventLoop&)
+    {
+        breakEventLoop();
+    }
+
+    int answerSum = 0;
+    const Query* lastMessage = nullptr;
+    std::atomic<int> replies{0};
+};
+
+TEST(EventThreadTest, RequestReplyReusesMessage)
+{
+    constexpr int NUM_REQUESTS = 100;
+
+    mla::ObjectPool<Query> pool;
+    ServerThread server;
+    ClientThread client;
+    server.start();
+    client.start();
+
+    for(int i = 1; i <= NUM_REQUESTS; ++i)
+    {
+        auto message = pool.acquire();
+        message->question = i;
+        client.request(server, std::move(message));
+        while(client.replies < i)
+            std::this_thread::yield();
+    }
+
+    server.push(ServerEvent{BreakEventLoop{}});
+    client.push(ClientEvent{BreakEventLoop{}});
+    server.join();
+    client.join();
+
+    EXPECT_EQ(client.answerSum, NUM_REQUESTS * (NUM_REQUESTS + 1));
+    // One request in flight at a time, so the same message is reused
+    EXPECT_EQ(pool.capacity(), 1);
+    EXPECT_EQ(client.lastMessage->history.size(), NUM_REQUESTS);
+}
+
+TEST(EventThreadTest, RequestDroppedWithoutReply)
+{
+    mla::ObjectPool<Query> pool;
+    ClientThread client;
+    {
+        mla::thread::Request<Query> request(pool.acquire(), client);
+    }
+    EXPECT_EQ(client.replies, 0);
+    auto message = pool.acquire();
+    EXPECT_EQ(pool.capacity(), 1);
+}
+
+// Handlers that take the event by non-const reference cannot run on a const
+// event, and fail loudly in release builds as well
+TEST(EventThreadTest, ConstEventToMutableHandlerThrows)
+{
+    ClientThread client;
+    const ClientEvent event{mla::thread::Reply<Query>{}};
+    EXPECT_THROW(client.processEvent(event), std::logic_error);
+}
+
+struct LaneEvent
+{
+    mla::thread::Lane lane;
+};
+
+using LaneTestEvent = std::variant<std::monostate, LaneEvent, BreakEventLoop>;
+
+class LaneThread : public mla::thread::EventThread<LaneThread, LaneTestEvent>
+{
+public:
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const LaneEvent& event)
+    {
+        lanes.push_back(event.lane);
+    }
+
+    void onEvent(const BreakEventLoop&)
+    {
+        breakEventLoop();
+    }
+
+    // Queue count events into each lane before the loop runs
+    void fill(int count)
+    {
+        using mla::thread::Lane;
+        for(auto lane : {Lane::Bulk, Lane::Default, Lane::Control})
+        {
+            for(int i = 0; i < count; ++i)
+                push(LaneEvent{lane}, lane);
+        }
+    }
+
+    std::vector<mla::thread::Lane> lanes;
+};
+
+TEST(EventThreadTest, StrictLanePriority)
+{
+    using mla::thread::Lane;
+    LaneThread th;
+    th.fill(3);
+    th.push(BreakEventLoop{}, Lane::Bulk);
+    th.start();
+    th.join();
+
+    std::vector<Lane> expected{Lane::Control, Lane::Control, Lane::Control,
+                               Lane::Default, Lane::Default, Lane::Default,
+                               Lane::Bulk,    Lane::Bulk,    Lane::Bulk};
+    EXPECT_EQ(th.lanes, expected);
+}
+
+TEST(EventThreadTest, WeightedLanePriority)
+{
+    using mla::thread::Lane;
+    LaneThread th;
+    th.setWeightedPriority({2, 3, 1});
+    th.fill(4);
+    th.push(BreakEventLoop{}, Lane::Bulk);
+    th.start();
+    th.join();
+
+    // Rounds of 2 Control, 3 Default and 1 Bulk while the lanes last
+    std::vector<Lane> expected{
+        Lane::Control, Lane::Control, Lane::Default, Lane::Default,
+        Lane::Default, Lane::Bulk,    Lane::Control, Lane::Control,
+        Lane::Default, Lane::Bulk,    Lane::Bulk,    Lane::Bulk};
+    EXPECT_EQ(th.lanes, expected);
+
+    EXPECT_THROW(th.setWeightedPriority({1, 0, 1}), std::runtime_error);
+}
+
+TEST(EventThreadTest, ControlEventOvertakesQueuedEvents)
+{
+    using mla::thread::Lane;
+    LaneThread th;
+    for(int i = 0; i < 1000; ++i)
+        th.push(LaneEvent{Lane::Default});
+    th.push(BreakEventLoop{}, Lane::Control);
+    th.start();
+    th.join();
+
+    // The loop ends before any of the queued events
+    EXPECT_TRUE(th.lanes.empty());
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "mlafw/common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+using mla::Id;
+
+TEST(IdTests, UniqueAcrossThreads)
+{
+    constexpr int NUM_THREADS = 4;
+    constexpr int NUM_IDS = 3 * Id::kIdBlockSize;
+
+    std::vector<std::vector<std::uint64_t>> ids(NUM_THREADS);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < NUM_THREADS; ++i)
+    {
+        threads.emplace_back(
+            [&ids, i]
+            {
+                for(int j = 0; j < NUM_IDS; ++j)
+                    ids[i].push_back(Id::getId());
+            });
+    }
+    for(auto& thread : threads)
+        thread.join();
+
+    std::set<std::uint64_t> unique;
+    for(const auto& threadIds : ids)
+    {
+        EXPECT_TRUE(std::is_sorted(threadIds.begin(), threadIds.end()));
+        unique.insert(threadIds.begin(), threadIds.end());
+    }
+    EXPECT_EQ(unique.size(), static_cast<std::size_t>(NUM_THREADS * NUM_IDS));
+}
+
+TEST(IdTests, RoutedIdsCarryShardAndThread)
+{
+    auto first = Id::getRoutedId(7);
+    auto second = Id::getRoutedId(200);
+    EXPECT_EQ(Id::shardOf(first), 7);
+    EXPECT_EQ(Id::shardOf(second), 200);
+    EXPECT_EQ(Id::threadOf(first), Id::threadOf(second));
+    EXPECT_NE(first, second);
+
+    std::uint64_t other = 0;
+    std::thread([&other] { other = Id::getRoutedId(7); }).join();
+    EXPECT_EQ(Id::shardOf(other), 7);
+    EXPECT_NE(Id::threadOf(other), Id::threadOf(first));
+}
+
+TEST(IdTests, RoutedIdsUniqueAcrossThreadChurn)
+{
+    // More threads than there are thread indexes, one after another
+    constexpr int NUM_THREADS = (1 << Id::kThreadBits) + 100;
+    constexpr int NUM_IDS = 2;
+
+    std::set<std::uint64_t> ids;
+    std::set<std::uint16_t> indexes;
+    for(int i = 0; i < NUM_THREADS; ++i)
+    {
+        std::thread(
+            [&]
+            {
+                for(int j = 0; j < NUM_IDS; ++j)
+                {
+                    auto id = Id::getRoutedId(1);
+                    ids.insert(id);
+                    indexes.insert(Id::threadOf(id));
+                }
+            })
+            .join();
+    }
+    // Exited threads give their index back with the sequence reached
+    EXPECT_EQ(ids.size(), static_cast<std::size_t>(NUM_THREADS * NUM_IDS));
+    EXPECT_LT(indexes.size(), 10u);
+}
@@ -0,0 +1,398 @@
+#include <gtest/gtest.h>
+
+#include "mlafw/ipc.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using namespace std::chrono_literals;
+using mla::ipc::RemoteQueue;
+using mla::ipc::SharedRing;
+
+namespace {
+
+struct Ping
+{
+    int value;
+};
+
+struct Message
+{
+    std::uint32_t producer;
+    std::uint32_t sequence;
+};
+
+using Event = std::variant<std::monostate, Ping, Message>;
+
+class TestThread : public mla::thread::RingEventThread<TestThread, Event>
+{
+public:
+    using RingEventThread::RingEventThread;
+
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const Ping& ping)
+    {
+        pingSum += ping.value;
+        pings++;
+    }
+
+    void onEvent(const Message& message)
+    {
+        if(message.sequence != next[message.producer])
+            outOfOrder++;
+        next[message.producer] = message.sequence + 1;
+        messages++;
+    }
+
+    std::atomic<int> pings{0};
+    std::atomic<int> pingSum{0};
+    std::atomic<int> messages{0};
+    std::atomic<int> outOfOrder{0};
+    std::vector<std::uint32_t> next = std::vector<std::uint32_t>(8);
+};
+
+template<typename Predicate>
+bool waitFor(Predicate predicate)
+{
+    auto end = std::chrono::steady_clock::now() + 5s;
+    while(!predicate())
+    {
+        if(std::chrono::steady_clock::now() > end)
+            return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+// Event whose text may not fit the ring; codec<TextEvent> writes it anyway
+// and reports its full size
+struct Text
+{
+    std::string value;
+};
+
+using TextEvent = std::variant<std::monostate, Ping, Text>;
+
+class TextThread : public mla::thread::RingEventThread<TextThread, TextEvent>
+{
+public:
+    using RingEventThread::RingEventThread;
+
+    void onEvent(const std::monostate&)
+    {
+        empty++;
+    }
+
+    void onEvent(const Ping&)
+    {
+        pings++;
+    }
+
+    void onEvent(const Text& text)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        texts.push_back(text.value);
+    }
+
+    std::atomic<int> empty{0};
+    std::atomic<int> pings{0};
+    std::mutex mutex;
+    std::vector<std::string> texts;
+};
+
+std::string ringName()
+{
+    return "/mlafw-ipctest-" + std::to_string(::getpid());
+}
+
+} // namespace
+
+template<>
+struct mla::ipc::codec<TextEvent>
+{
+    static constexpr std::size_t max_size = 16;
+
+    static std::size_t encode(const TextEvent& event, std::span<std::byte> out)
+    {
+        if(auto* ping = std::get_if<Ping>(&event))
+        {
+            out[0] = std::byte{1};
+            std::memcpy(&out[1], &ping->value, sizeof(ping->value));
+            return 1 + sizeof(ping->value);
+        }
+        const auto& text = std::get<Text>(event).value;
+        out[0] = std::byte{2};
+        std::memcpy(&out[1], text.data(),
+                    std::min(text.size(), out.size() - 1));
+        return 1 + text.size();
+    }
+
+    static TextEvent decode(std::span<const std::byte> in)
+    {
+        if(in.empty())
+            return std::monostate{};
+        if(in[0] == std::byte{1})
+        {
+            Ping ping;
+            std::memcpy(&ping.value, &in[1], sizeof(ping.value));
+            return ping;
+        }
+        return Text{{reinterpret_cast<const char*>(&in[1]), in.size() - 1}};
+    }
+};
+
+TEST(SharedRingTest, PushAndPop)
+{
+    auto ring = SharedRing::anonymous(4, 16);
+    EXPECT_EQ(ring.capacity(), 4u);
+    EXPECT_TRUE(ring.empty());
+
+    for(std::uint32_t i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(ring.tryPush(std::as_bytes(std::span(&i, 1))));
+    }
+    std::uint32_t extra = 4;
+    EXPECT_FALSE(ring.tryPush(std::as_bytes(std::span(&extra, 1))));
+
+    for(std::uint32_t i = 0; i < 4; ++i)
+    {
+        std::uint32_t value = 0;
+        EXPECT_TRUE(ring.tryPop(
+            [&value](std::span<const std::byte> in)
+            {
+                ASSERT_EQ(in.size(), sizeof(value));
+                std::memcpy(&value, in.data(), sizeof(value));
+            }));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_TRUE(ring.empty());
+    EXPECT_FALSE(ring.tryPop([](std::span<const std::byte>) {}));
+}
+
+TEST(SharedRingTest, OversizedMessageThrows)
+{
+    auto ring = SharedRing::anonymous(4, 8);
+    std::byte large[16]{};
+    EXPECT_THROW(ring.tryPush(std::span<const std::byte>(large)),
+                 std::runtime_error);
+
+    // The slot is given up and skipped, and the ring keeps working
+    EXPECT_FALSE(ring.tryPop([](std::span<const std::byte>)
+                             { ADD_FAILURE() << "Abandoned slot read"; }));
+    EXPECT_TRUE(ring.empty());
+
+    std::byte small[8]{};
+    EXPECT_TRUE(ring.tryPush(std::span<const std::byte>(small)));
+    EXPECT_THROW(ring.tryPush(std::span<const std::byte>(large)),
+                 std::runtime_error);
+    EXPECT_TRUE(ring.tryPush(std::span<const std::byte>()));
+
+    std::vector<std::size_t> sizes;
+    while(ring.tryPop([&sizes](std::span<const std::byte> in)
+                      { sizes.push_back(in.size()); }))
+    {
+    }
+    EXPECT_EQ(sizes, (std::vector<std::size_t>{8, 0}));
+}
+
+// A writer that throws gives its slot up like an oversized message
+TEST(SharedRingTest, ThrowingWriterAbandonsSlot)
+{
+    auto ring = SharedRing::anonymous(4, 8);
+    EXPECT_THROW(ring.tryPush([](std::span<std::byte>) -> std::size_t
+                              { throw std::runtime_error("Codec failed"); }),
+                 std::runtime_error);
+
+    std::byte small[4]{};
+    EXPECT_TRUE(ring.tryPush(std::span<const std::byte>(small)));
+
+    std::vector<std::size_t> sizes;
+    while(ring.tryPop([&sizes](std::span<const std::byte> in)
+                      { sizes.push_back(in.size()); }))
+    {
+    }
+    EXPECT_EQ(sizes, (std::vector<std::size_t>{4}));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SharedRingTest, AttachRejectsCorruptRing)
+{
+    // The mapping must hold every slot
+    {
+        auto ring = SharedRing::anonymous(8, 32);
+        int fd = ::dup(ring.fd());
+        ASSERT_EQ(::ftruncate(fd, 256), 0);
+        EXPECT_THROW(SharedRing::attach(fd), std::runtime_error);
+    }
+
+    // The capacity, after the 8 byte magic, must be a power of two
+    {
+        auto ring = SharedRing::anonymous(8, 32);
+        int fd = ::dup(ring.fd());
+        std::uint32_t capacity = 6;
+        ASSERT_EQ(::pwrite(fd, &capacity, sizeof(capacity), 8),
+                  static_cast<ssize_t>(sizeof(capacity)));
+        EXPECT_THROW(SharedRing::attach(fd), std::runtime_error);
+    }
+
+    auto ring = SharedRing::anonymous(8, 32);
+    auto other = SharedRing::attach(::dup(ring.fd()));
+    EXPECT_EQ(other.capacity(), 8u);
+}
+
+TEST(SharedRingTest, NamedRing)
+{
+    auto name = ringName();
+    SharedRing::unlink(name);
+
+    auto ring = SharedRing::create(name, 8, 32);
+    EXPECT_THROW(SharedRing::create(name, 8, 32), std::runtime_error);
+
+    auto other = SharedRing::open(name);
+    EXPECT_EQ(other.capacity(), 8u);
+    EXPECT_EQ(other.slotSize(), 32u);
+
+    Ping ping{42};
+    RemoteQueue<Ping>(other).push(ping);
+    ring.tryPop([&ping](std::span<const std::byte> in)
+                { ping = mla::ipc::codec<Ping>::decode(in); });
+    EXPECT_EQ(ping.value, 42);
+
+    SharedRing::unlink(name);
+    EXPECT_THROW(SharedRing::open(name), std::runtime_error);
+}
+
+TEST(SharedRingTest, BlockingPushWaitsForSpace)
+{
+    auto ring = SharedRing::anonymous(2, 8);
+    constexpr int kCount = 1000;
+
+    std::thread producer(
+        [&ring]
+        {
+            RemoteQueue<int> queue(ring);
+            for(int i = 0; i < kCount; ++i)
+                queue.push(i);
+        });
+
+    int expected = 0;
+    while(expected < kCount)
+    {
+        ring.wait();
+        while(ring.tryPop(
+            [&expected](std::span<const std::byte> in)
+            {
+                EXPECT_EQ(mla::ipc::codec<int>::decode(in), expected);
+                ++expected;
+            }))
+        {
+        }
+    }
+    producer.join();
+}
+
+TEST(RingEventThreadTest, LocalAndRemoteEvents)
+{
+    auto ring = SharedRing::anonymous(64, sizeof(Event));
+    TestThread thread(ring);
+    thread.start();
+
+    constexpr int kProducers = 4;
+    constexpr std::uint32_t kMessages = 5000;
+    std::vector<std::thread> producers;
+    for(std::uint32_t p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back(
+            [&ring, p]
+            {
+                RemoteQueue<Event> queue(ring);
+                for(std::uint32_t i = 0; i < kMessages; ++i)
+                    queue.push(Message{p, i});
+            });
+    }
+    for(int i = 1; i <= 100; ++i)
+        thread.push(Ping{i});
+    for(auto& producer : producers)
+        producer.join();
+
+    EXPECT_TRUE(waitFor(
+        [&] { return thread.messages.load() == kProducers * kMessages; }));
+    EXPECT_TRUE(waitFor([&] { return thread.pings.load() == 100; }));
+    EXPECT_EQ(thread.pingSum.load(), 5050);
+    EXPECT_EQ(thread.outOfOrder.load(), 0);
+
+    thread.exit();
+    thread.join();
+}
+
+TEST(RingEventThreadTest, OversizedEventIsSkipped)
+{
+    auto ring = SharedRing::anonymous(8, 16);
+    TextThread thread(ring);
+
+    RemoteQueue<TextEvent> queue(ring);
+    queue.push(Text{"short"});
+    EXPECT_THROW(queue.push(Text{std::string(64, 'x')}), std::runtime_error);
+    queue.push(Ping{1});
+    queue.push(Text{"after"});
+
+    thread.start();
+    EXPECT_TRUE(waitFor([&] { return thread.pings.load() == 1; }));
+    EXPECT_TRUE(waitFor(
+        [&]
+        {
+            std::lock_guard<std::mutex> lock(thread.mutex);
+            return thread.texts.size() == 2;
+        }));
+    EXPECT_EQ(thread.empty.load(), 0);
+
+    thread.exit();
+    thread.join();
+    EXPECT_EQ(thread.texts, (std::vector<std::string>{"short", "after"}));
+}
+
+TEST(RingEventThreadTest, OtherProcess)
+{
+    auto ring = SharedRing::anonymous(16, sizeof(Event));
+    TestThread thread(ring);
+    thread.start();
+
+    constexpr std::uint32_t kMessages = 10000;
+    pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if(child == 0)
+    {
+        RemoteQueue<Event> queue(ring);
+        for(std::uint32_t i = 0; i < kMessages; ++i)
+            queue.push(Message{0, i});
+        ::_exit(0);
+    }
+
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_TRUE(
+        waitFor([&] { return thread.messages.load() == kMessages; }));
+    EXPECT_EQ(thread.outOfOrder.load(), 0);
+
+    // Idle, the thread sleeps on the ring and still wakes for local events
+    std::this_thread::sleep_for(10ms);
+    thread.push(Ping{1});
+    EXPECT_TRUE(waitFor([&] { return thread.pings.load() == 1; }));
+
+    thread.exit();
+    thread.join();
+}
@@ -0,0 +1,118 @@
+// Queue instrumentation is compiled in for this test only
+#ifndef MLA_EVENT_METRICS
+#define MLA_EVENT_METRICS
+#endif
+
+#include <gtest/gtest.h>
+
+#include "mlafw/eventthread.h"
+#include "mlafw/metrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <variant>
+
+using namespace std::chrono_literals;
+using mla::thread::LatencyHistogram;
+
+namespace {
+
+struct Fast {};
+struct Slow {};
+
+using MetricsEvent = std::variant<std::monostate, Fast, Slow>;
+
+class MeasuredThread
+    : public mla::thread::EventThread<MeasuredThread, MetricsEvent>
+{
+public:
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const Fast&)
+    {
+        handled++;
+    }
+
+    void onEvent(const Slow&)
+    {
+        std::this_thread::sleep_for(2ms);
+        handled++;
+    }
+
+    std::atomic<int> handled{0};
+};
+
+} // namespace
+
+TEST(MetricsTest, HistogramBuckets)
+{
+    for(std::uint64_t ns : {0ull, 7ull, 8ull, 100ull, 12345ull, 1ull << 39})
+    {
+        const auto bucket = LatencyHistogram::bucketOf(ns);
+        EXPECT_LE(LatencyHistogram::lowerBound(bucket), ns);
+        EXPECT_GT(LatencyHistogram::lowerBound(bucket + 1), ns);
+    }
+
+    // Bucket width stays within 1/8 of the value
+    const auto bucket = LatencyHistogram::bucketOf(1000000);
+    const auto width = LatencyHistogram::lowerBound(bucket + 1) -
+                       LatencyHistogram::lowerBound(bucket);
+    EXPECT_LE(width * 8, 1000000u);
+
+    EXPECT_EQ(LatencyHistogram::bucketOf(~0ull), LatencyHistogram::kBuckets - 1);
+
+    LatencyHistogram histogram;
+    histogram.counts[LatencyHistogram::bucketOf(100)] = 99;
+    histogram.counts[LatencyHistogram::bucketOf(5000)] = 1;
+    EXPECT_EQ(histogram.count(), 100u);
+    EXPECT_LT(histogram.percentile(0.5), 128u);
+    EXPECT_GE(histogram.percentile(1.0), 5000u);
+}
+
+// A clock read that went backwards counts as no time, not as 2^64 ns
+TEST(MetricsTest, ElapsedNeverWraps)
+{
+    using Metrics = mla::thread::QueueMetrics<MetricsEvent>;
+    EXPECT_EQ(Metrics::elapsed(100, 250), 150u);
+    EXPECT_EQ(Metrics::elapsed(250, 250), 0u);
+    EXPECT_EQ(Metrics::elapsed(250, 100), 0u);
+}
+
+TEST(MetricsTest, CountsWaitAndHandlerTime)
+{
+    constexpr int NUM_FAST = 1000;
+    constexpr int NUM_SLOW = 5;
+
+    MeasuredThread thread;
+    for(int i = 0; i < NUM_FAST; ++i)
+        thread.push(Fast{});
+    for(int i = 0; i < NUM_SLOW; ++i)
+        thread.push(Slow{});
+
+    auto queued = thread.metrics();
+    EXPECT_EQ(queued.processed, 0u);
+    EXPECT_EQ(queued.depth, static_cast<std::size_t>(NUM_FAST + NUM_SLOW));
+
+    thread.start();
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(thread.handled < NUM_FAST + NUM_SLOW &&
+          std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    thread.exit();
+    thread.join();
+
+    auto snapshot = thread.metrics();
+    EXPECT_EQ(snapshot.depth, 0u);
+    // The event that stops the loop is counted as well
+    EXPECT_EQ(snapshot.processed, NUM_FAST + NUM_SLOW + 1u);
+    EXPECT_EQ(snapshot.wait.count(), snapshot.processed);
+
+    ASSERT_EQ(snapshot.handlers.size(), 3u);
+    EXPECT_EQ(snapshot.handlers[0].count, 1u);
+    EXPECT_EQ(snapshot.handlers[1].count, static_cast<std::uint64_t>(NUM_FAST));
+    EXPECT_EQ(snapshot.handlers[2].count, static_cast<std::uint64_t>(NUM_SLOW));
+    EXPECT_GE(snapshot.handlers[2].maxNs, 2000000u);
+    EXPECT_GE(snapshot.handlers[2].totalNs, NUM_SLOW * 2000000u);
+    EXPECT_LT(snapshot.handlers[1].totalNs, snapshot.handlers[2].totalNs);
+}
@@ -1,7 +1,18 @@
 #include "mlafw/arrayquickmap.h"
+#include "mlafw/mappedquickmap.h"
 #include "mlafw/vectorquickmap.h"
 #include <gtest/gtest.h>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
 // Test fixture for both ArrayQuickMap and VectorQuickMap
 template <typename MapType>
@@ -86,6 +97,135 @@ TYPED_TEST(QuickMapTest, Find)
     EXPECT_EQ(value, std::nullopt);
 }
 
+TYPED_TEST(QuickMapTest, IteratorSkipsRemoved)
+{
+    for(int i = 0; i < 10; ++i)
+    {
+        this->map.insert(std::to_string(i), i);
+    }
+    for(int i = 0; i < 10; i += 2)
+    {
+        this->map.remove(std::to_string(i));
+    }
+
+    int sum = 0;
+    size_t count = 0;
+    for(const auto& pair : this->map)
+    {
+        sum += pair.second;
+        ++count;
+    }
+    EXPECT_EQ(count, 5);
+    EXPECT_EQ(sum, 1 + 3 + 5 + 7 + 9);
+}
+
+TYPED_TEST(QuickMapTest, ForEach)
+{
+    for(int i = 0; i < 10; ++i)
+    {
+        this->map.insert(std::to_string(i), i);
+    }
+
+    int sum = 0;
+    size_t count = 0;
+    this->map.for_each(
+        [&](const std::string&, int& value)
+        {
+            sum += value;
+            ++count;
+            value *= 2;
+        });
+    EXPECT_EQ(count, 10);
+    EXPECT_EQ(sum, 45);
+    EXPECT_EQ(this->map.get("9"), 18);
+}
+
+// Visit a map of 1000 int entries, large enough to be split into several
+// ranges, on 4 threads
+template <typename Map>
+void checkParallelForEach(Map& map)
+{
+    for(int i = 0; i < 1000; ++i)
+    {
+        map.insert(i, i);
+    }
+    ASSERT_GT(map.capacity(), 4 * 64);
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<long> sum{0};
+    std::atomic<size_t> count{0};
+    map.for_each(
+        [&](const int&, int& value)
+        {
+            sum += value;
+            ++count;
+            value *= 2;
+            std::lock_guard lock(mutex);
+            threads.insert(std::this_thread::get_id());
+        },
+        4);
+    EXPECT_EQ(count, 1000);
+    EXPECT_EQ(sum, 999 * 1000 / 2);
+    EXPECT_EQ(map.get(999), 1998);
+    EXPECT_GT(threads.size(), 1);
+
+    EXPECT_THROW(map.for_each(
+                     [](const int& key, int&)
+                     {
+                         if(key == 500)
+                             throw std::runtime_error("Stop");
+                     },
+                     4),
+                 std::runtime_error);
+}
+
+TEST(ArrayQuickMapTest, ParallelForEach)
+{
+    mla::ArrayQuickMap<int, int, 2048> map;
+    checkParallelForEach(map);
+}
+
+TEST(VectorQuickMapTest, ParallelForEach)
+{
+    mla::VectorQuickMap<int, int> map;
+    checkParallelForEach(map);
+}
+
+// Keys hashing to one slot form a probe chain. Removing one in the middle
+// must not hide the keys displaced past it.
+template <typename Map>
+void checkRemoveKeepsDisplacedKeys(Map& map)
+{
+    const int step = static_cast<int>(map.capacity());
+    map.insert(1, 10);
+    map.insert(1 + step, 20);
+    map.insert(1 + 2 * step, 30);
+    map.insert(2, 40);
+
+    map.remove(1 + step);
+    EXPECT_EQ(map.get(1 + 2 * step), 30);
+    EXPECT_EQ(map.get(2), 40);
+    EXPECT_EQ(map.get(1 + step), std::nullopt);
+
+    map.remove(1);
+    EXPECT_EQ(map.get(1 + 2 * step), 30);
+    EXPECT_EQ(map.get(2), 40);
+    EXPECT_EQ(map.size(), 2);
+}
+
+TEST(ArrayQuickMapTest, RemoveKeepsDisplacedKeys)
+{
+    mla::ArrayQuickMap<int, int, 16> map;
+    checkRemoveKeepsDisplacedKeys(map);
+}
+
+TEST(VectorQuickMapTest, RemoveKeepsDisplacedKeys)
+{
+    mla::VectorQuickMap<int, int> map;
+    checkRemoveKeepsDisplacedKeys(map);
+}
+
 // Specific test for ArrayQuickMap to check capacity
 TEST(ArrayQuickMapTest, Capacity)
 {
@@ -106,8 +246,129 @@ TEST(VectorQuickMapTest, Rehash)
     {
         EXPECT_EQ(map.get(i), i);
     }
+
+    size_t count = 0;
+    for(const auto& pair : map)
+    {
+        EXPECT_EQ(pair.first, pair.second);
+        ++count;
+    }
+    EXPECT_EQ(count, 100);
 }
 
+// Dump a VectorQuickMap and look the entries up through the mapped image
+TEST(VectorQuickMapTest, SnapshotRoundTrip)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+                      "mlafw_quickmaptest_snapshot.bin";
+
+    mla::VectorQuickMap<int, double> map;
+    for(int i = 0; i < 1000; ++i)
+    {
+        map.insert(i, i * 0.5);
+    }
+    map.remove(999);
+    map.dump(path.string());
+
+    mla::MappedQuickMap<int, double> mapped(path.string());
+    EXPECT_EQ(mapped.size(), map.size());
+    EXPECT_EQ(mapped.capacity(), map.capacity());
+    for(int i = 0; i < 999; ++i)
+    {
+        EXPECT_EQ(mapped.get(i), i * 0.5);
+    }
+    EXPECT_EQ(mapped.get(999), std::nullopt);
+    EXPECT_FALSE(mapped.contains(5000));
+
+    std::filesystem::remove(path);
+}
+
+TEST(VectorQuickMapTest, SnapshotTypeMismatch)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+                      "mlafw_quickmaptest_mismatch.bin";
+
+    mla::VectorQuickMap<int, int> map;
+    map.insert(1, 1);
+    map.dump(path.string());
+
+    using Mismatch = mla::MappedQuickMap<int, double>;
+    EXPECT_THROW(Mismatch{path.string()}, std::runtime_error);
+    using Missing = mla::MappedQuickMap<int, int>;
+    EXPECT_THROW(Missing{path.string() + ".missing"}, std::runtime_error);
+
+    std::filesystem::remove(path);
+}
+
+// A capacity whose byte size wraps around to the file size is rejected
+TEST(VectorQuickMapTest, SnapshotCapacityOverflow)
+{
+    const auto path = std::filesystem::temp_directory_path() /
+                      "mlafw_quickmaptest_overflow.bin";
+
+    mla::VectorQuickMap<int, int> map;
+    map.insert(1, 1);
+    map.dump(path.string());
+
+    detail::util::QuickMapSnapshotHeader header;
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    }
+    header.capacity +=
+        std::uint64_t{1} << (64 - std::countr_zero(header.entry_size));
+    {
+        std::fstream out(path, std::ios::binary | std::ios::in |
+                                   std::ios::out);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    using Mapped = mla::MappedQuickMap<int, int>;
+    EXPECT_THROW(Mapped{path.string()}, std::runtime_error);
+
+    std::filesystem::remove(path);
+}
+
+// Padding and removed entries do not end up in the file
+TEST(VectorQuickMapTest, SnapshotReproducible)
+{
+    const auto dir = std::filesystem::temp_directory_path();
+    const auto first = dir / "mlafw_quickmaptest_first.bin";
+    const auto second = dir / "mlafw_quickmaptest_second.bin";
+
+    auto dump = [](double removed, const std::filesystem::path& path)
+    {
+        mla::VectorQuickMap<std::uint8_t, double> map;
+        for(std::uint8_t i = 0; i < 10; ++i)
+        {
+            map.insert(i, i < 5 ? 1.0 : removed);
+        }
+        for(std::uint8_t i = 5; i < 10; ++i)
+        {
+            map.remove(i);
+        }
+        map.dump(path.string());
+    };
+    dump(2.0, first);
+    dump(3.0, second);
+
+    auto read = [](const std::filesystem::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), {});
+    };
+    EXPECT_EQ(read(first), read(second));
+
+    std::filesystem::remove(first);
+    std::filesystem::remove(second);
+}
+
+template <typename K, typename V>
+concept Mappable = requires { typename mla::MappedQuickMap<K, V>; };
+
+static_assert(Mappable<int, double>);
+static_assert(!Mappable<std::string, int>);
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+
+#include "mlafw/reactor.h"
+#include "mlafw/timerfd.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using namespace std::chrono_literals;
+using mla::thread::IoReady;
+
+namespace {
+
+struct Ping {};
+
+using Event = std::variant<std::monostate, Ping>;
+
+class TestReactor : public mla::thread::ReactorThread<TestReactor, Event>
+{
+public:
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const Ping&)
+    {
+        pingThread = std::this_thread::get_id();
+        pings++;
+    }
+
+    void onEvent(const IoReady& ready)
+    {
+        ioThread = std::this_thread::get_id();
+        if(onReady)
+        {
+            onReady(ready);
+            return;
+        }
+        char buffer[64];
+        [[maybe_unused]] auto bytes = ::read(ready.fd, buffer, sizeof(buffer));
+        reads++;
+    }
+
+    std::function<void(const IoReady&)> onReady;
+    std::atomic<int> pings{0};
+    std::atomic<int> reads{0};
+    std::thread::id pingThread;
+    std::thread::id ioThread;
+};
+
+struct Pipe
+{
+    Pipe()
+    {
+        [[maybe_unused]] auto result = ::pipe(fds);
+    }
+
+    ~Pipe()
+    {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    void write()
+    {
+        [[maybe_unused]] auto bytes = ::write(fds[1], "x", 1);
+    }
+
+    int fds[2];
+};
+
+template<typename Predicate>
+bool waitFor(Predicate predicate)
+{
+    auto end = std::chrono::steady_clock::now() + 2s;
+    while(!predicate())
+    {
+        if(std::chrono::steady_clock::now() > end)
+            return false;
+        std::this_thread::sleep_for(100us);
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(ReactorTests, IoAndEventsOnSameThread)
+{
+    Pipe pipe;
+    TestReactor reactor;
+    reactor.add(pipe.fds[0]);
+    reactor.start();
+
+    pipe.write();
+    reactor.push(Ping{});
+    EXPECT_TRUE(waitFor([&] { return reactor.reads == 1; }));
+    EXPECT_TRUE(waitFor([&] { return reactor.pings == 1; }));
+
+    reactor.exit();
+    reactor.join();
+    EXPECT_EQ(reactor.ioThread, reactor.pingThread);
+    EXPECT_NE(reactor.ioThread, std::this_thread::get_id());
+}
+
+TEST(ReactorTests, PushWakesParkedLoop)
+{
+    TestReactor reactor;
+    reactor.start();
+
+    for(int i = 1; i <= 100; ++i)
+    {
+        // Give the loop time to park in epoll_wait()
+        std::this_thread::sleep_for(200us);
+        reactor.push(Ping{});
+        ASSERT_TRUE(waitFor([&] { return reactor.pings == i; }));
+    }
+
+    reactor.exit();
+    reactor.join();
+}
+
+TEST(ReactorTests, PushFromManyThreads)
+{
+    constexpr int NUM_THREADS = 4;
+    constexpr int NUM_EVENTS = 10000;
+
+    TestReactor reactor;
+    reactor.start();
+
+    std::vector<std::thread> producers;
+    for(int i = 0; i < NUM_THREADS; ++i)
+    {
+        producers.emplace_back(
+            [&reactor]
+            {
+                for(int j = 0; j < NUM_EVENTS; ++j)
+                    reactor.push(Ping{});
+            });
+    }
+    for(auto& producer : producers)
+        producer.join();
+
+    EXPECT_TRUE(
+        waitFor([&] { return reactor.pings == NUM_THREADS * NUM_EVENTS; }));
+    reactor.exit();
+    reactor.join();
+}
+
+TEST(ReactorTests, RemoveFromHandler)
+{
+    Pipe first;
+    Pipe second;
+    first.write();
+    second.write();
+
+    // Both descriptors are ready in the first epoll_wait()
+    TestReactor reactor;
+    reactor.add(first.fds[0]);
+    reactor.add(second.fds[0]);
+    std::atomic<int> ready{0};
+    reactor.onReady = [&](const IoReady&)
+    {
+        reactor.remove(first.fds[0]);
+        reactor.remove(second.fds[0]);
+        ready++;
+    };
+    reactor.start();
+
+    std::this_thread::sleep_for(20ms);
+    reactor.exit();
+    reactor.join();
+    EXPECT_EQ(ready, 1);
+}
+
+TEST(ReactorTests, DrivesFdTimer)
+{
+    mla::timer::FdTimer timer;
+    TestReactor reactor;
+    reactor.add(timer.backend().fd());
+    reactor.onReady = [&](const IoReady&) { timer.poll(); };
+
+    std::atomic<int> fired{0};
+    std::thread::id firedOn;
+    timer.order(
+        [&](mla::timer::timer_id)
+        {
+            firedOn = std::this_thread::get_id();
+            fired++;
+        },
+        2ms);
+    reactor.start();
+
+    EXPECT_TRUE(waitFor([&] { return fired == 1; }));
+    reactor.exit();
+    reactor.join();
+    EXPECT_EQ(firedOn, reactor.ioThread);
+}
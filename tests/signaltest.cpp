@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+
+#include "mlafw/eventthread.h"
+#include "mlafw/signal.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Quote
+{
+    std::string symbol;
+    double price = 0.0;
+};
+
+using SignalEvent = std::variant<std::monostate, mla::signal::Shared<Quote>>;
+
+class QuoteListener
+    : public mla::thread::EventThread<QuoteListener, SignalEvent>
+{
+public:
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const mla::signal::Shared<Quote>& quote)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(quote);
+        count++;
+    }
+
+    std::mutex mutex;
+    std::vector<mla::signal::Shared<Quote>> received;
+    std::atomic<int> count{0};
+};
+
+void waitFor(const std::atomic<int>& value, int expected)
+{
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(value.load() < expected && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+}
+
+} // namespace
+
+TEST(SignalTest, DirectSlotsRunOnEmit)
+{
+    mla::signal::Signal<int> signal;
+    int first = 0;
+    int second = 0;
+
+    auto a = signal.connect([&](const int& value) { first += value; });
+    auto b = signal.connect([&](const int& value) { second += value; });
+    EXPECT_NE(a, b);
+    EXPECT_EQ(signal.size(), 2u);
+
+    signal.emit(5);
+    EXPECT_EQ(first, 5);
+    EXPECT_EQ(second, 5);
+
+    EXPECT_TRUE(signal.disconnect(a));
+    EXPECT_FALSE(signal.disconnect(a));
+    signal.emit(1);
+    EXPECT_EQ(first, 5);
+    EXPECT_EQ(second, 6);
+}
+
+TEST(SignalTest, QueuedSubscribersShareOnePayload)
+{
+    mla::signal::Signal<Quote> signal;
+    QuoteListener listeners[3];
+
+    for(auto& listener : listeners)
+    {
+        signal.connect(listener);
+        listener.start();
+    }
+
+    signal.emit(Quote{"ACME", 12.5});
+
+    for(auto& listener : listeners)
+        waitFor(listener.count, 1);
+
+    for(auto& listener : listeners)
+    {
+        listener.exit();
+        listener.join();
+    }
+
+    const Quote* payload = listeners[0].received.at(0).get();
+    EXPECT_EQ(payload->symbol, "ACME");
+    for(auto& listener : listeners)
+    {
+        ASSERT_EQ(listener.received.size(), 1u);
+        EXPECT_EQ(listener.received[0].get(), payload);
+    }
+}
+
+TEST(SignalTest, SlotCanDisconnectDuringEmit)
+{
+    mla::signal::Signal<int> signal;
+    int calls = 0;
+    mla::signal::Connection self;
+
+    self = signal.connect(
+        [&](const int&)
+        {
+            calls++;
+            signal.disconnect(self);
+        });
+
+    signal.emit(1);
+    signal.emit(2);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(signal.size(), 0u);
+}
+
+TEST(SignalTest, ConnectDisconnectWhileEmitting)
+{
+    mla::signal::Signal<int> signal;
+    std::atomic<int> calls{0};
+    std::atomic<bool> done{false};
+
+    signal.connect([&](const int&) { calls++; });
+
+    std::vector<std::jthread> emitters;
+    for(int i = 0; i < 2; ++i)
+        emitters.emplace_back(
+            [&]
+            {
+                while(!done.load())
+                    signal.emit(1);
+            });
+
+    // Keep replacing the list until the emitters have run a while
+    for(int i = 0; i < 1000 || calls.load() < 1000; ++i)
+    {
+        auto connection = signal.connect([](const int&) {});
+        signal.disconnect(connection);
+        std::this_thread::yield();
+    }
+
+    done.store(true);
+    emitters.clear();
+
+    EXPECT_EQ(signal.size(), 1u);
+}
+
+TEST(SignalTest, ReplacedListsFreedWhileEmitsOverlap)
+{
+    mla::signal::Signal<int> signal;
+    std::atomic<int> copies{0};
+    std::atomic<bool> done{false};
+
+    // Counts the copies of it kept alive by the slot lists
+    struct Tracked
+    {
+        explicit Tracked(std::atomic<int>& count) : count(&count) { ++count; }
+        Tracked(const Tracked& other) : count(other.count) { ++*count; }
+        ~Tracked() { --*count; }
+        void operator()(const int&) const {}
+        std::atomic<int>* count;
+    };
+
+    // Two emitters hand over so that one of them is always inside emit()
+    std::atomic<bool> inside[2]{false, false};
+    std::atomic<int> turn{0};
+    std::atomic<int> handovers{0};
+    signal.connect(
+        [&](const int& self)
+        {
+            inside[self].store(true);
+            while(!done.load() &&
+                  !(inside[self ^ 1].load() && turn.load() == self))
+                std::this_thread::yield();
+            turn.store(self ^ 1);
+            handovers++;
+            inside[self].store(false);
+        });
+
+    std::vector<std::jthread> emitters;
+    for(int i = 0; i < 2; ++i)
+        emitters.emplace_back(
+            [&signal, &done, i]
+            {
+                while(!done.load())
+                    signal.emit(i);
+            });
+
+    while(handovers.load() == 0)
+        std::this_thread::yield();
+    for(int i = 0; i < 1000 || handovers.load() < 100; ++i)
+    {
+        auto connection = signal.connect(Tracked(copies));
+        signal.disconnect(connection);
+        std::this_thread::yield();
+    }
+    EXPECT_TRUE(inside[0].load() || inside[1].load());
+    EXPECT_LT(copies.load(), 10);
+
+    done.store(true);
+    emitters.clear();
+}
+
+// Emitters that stall inside emit() while others come and go and the list
+// is replaced underneath them; a list freed too early shows up as a dead
+// slot, or as a use after free when built with -fsanitize=address/thread
+TEST(SignalTest, SlowReadersKeepTheirList)
+{
+    static constexpr std::uint32_t kAlive = 0x51A7ED00;
+
+    struct Canary
+    {
+        Canary(std::atomic<int>& failures) : failures(&failures) {}
+        Canary(const Canary& other) : failures(other.failures) {}
+        ~Canary() { alive = 0; }
+        void operator()(const int& slow) const
+        {
+            if(alive != kAlive)
+                ++*failures;
+            if(slow)
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            if(alive != kAlive)
+                ++*failures;
+        }
+        std::atomic<int>* failures;
+        volatile std::uint32_t alive = kAlive;
+    };
+
+    mla::signal::Signal<int> signal;
+    std::atomic<int> failures{0};
+    std::atomic<bool> done{false};
+    std::atomic<int> emits{0};
+    signal.connect(Canary(failures));
+
+    std::vector<std::jthread> emitters;
+    for(int i = 0; i < 4; ++i)
+        emitters.emplace_back(
+            [&, slow = i == 0]
+            {
+                while(!done.load())
+                {
+                    signal.emit(slow);
+                    emits++;
+                }
+            });
+
+    for(int i = 0; i < 20000 || emits.load() < 20000; ++i)
+    {
+        auto connection = signal.connect(Canary(failures));
+        signal.disconnect(connection);
+    }
+
+    done.store(true);
+    emitters.clear();
+
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(signal.size(), 1u);
+}
+
+TEST(SignalTest, EmptySharedPayloadThrows)
+{
+    mla::signal::Signal<int> signal;
+    int calls = 0;
+    signal.connect([&](const int&) { calls++; });
+
+    EXPECT_THROW(signal.emit(mla::signal::Shared<int>()), std::runtime_error);
+    EXPECT_EQ(calls, 0);
+
+    signal.emit(std::make_shared<const int>(1));
+    EXPECT_EQ(calls, 1);
+}
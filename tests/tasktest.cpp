@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+
+#include "mlafw/eventthread.h"
+#include "mlafw/shardedtimer.h"
+#include "mlafw/task.h"
+#include "mlafw/timer.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Stop {};
+
+struct Query
+{
+    int question = 0;
+    int answer = 0;
+};
+
+using ServerEvent =
+    mla::thread::Envelope<Stop, mla::thread::Request<Query>>;
+
+class Server : public mla::thread::EventThread<Server, ServerEvent>
+{
+public:
+    void onEvent(const Stop&)
+    {
+        breakEventLoop();
+    }
+
+    // Negative questions are dropped unanswered
+    void onEvent(mla::thread::Request<Query>& request)
+    {
+        if(request->question < 0)
+            return;
+        request->answer = request->question + 1;
+        std::move(request).reply();
+    }
+};
+
+using ClientEvent = std::variant<Stop, mla::thread::Resume>;
+
+class Client : public mla::thread::EventThread<Client, ClientEvent>
+{
+public:
+    void onEvent(const Stop&)
+    {
+        breakEventLoop();
+    }
+
+    void waitFinished()
+    {
+        while(!finished)
+            std::this_thread::yield();
+    }
+
+    std::thread::id threadId() const
+    {
+        return getId();
+    }
+
+    std::atomic<bool> finished{false};
+};
+
+// Runs every job on a fresh thread
+struct ThreadExecutor
+{
+    template<typename Fn>
+    void submit(Fn fn)
+    {
+        workers.emplace_back(std::move(fn));
+    }
+
+    std::vector<std::jthread> workers;
+};
+
+mla::task<int> add(int a, int b)
+{
+    co_return a + b;
+}
+
+mla::task<int> sum(int count)
+{
+    int total = 0;
+    for(int i = 0; i < count; ++i)
+        total += co_await add(i, 1);
+    co_return total;
+}
+
+mla::task<> fail()
+{
+    throw std::runtime_error("failed");
+    co_return;
+}
+
+} // namespace
+
+TEST(TaskTest, AwaitNestedTasks)
+{
+    Client client;
+    client.start();
+
+    int result = 0;
+    client.spawn([](Client& client, int& result) -> mla::task<>
+                 {
+                     result = co_await sum(10);
+                     client.finished = true;
+                 }(client, result));
+
+    client.waitFinished();
+    client.push(Stop{});
+    client.join();
+
+    EXPECT_EQ(result, 55);
+}
+
+TEST(TaskTest, ExceptionPropagatesToAwaiter)
+{
+    Client client;
+    client.start();
+
+    bool caught = false;
+    client.spawn([](Client& client, bool& caught) -> mla::task<>
+                 {
+                     try
+                     {
+                         co_await fail();
+                     }
+                     catch(const std::runtime_error&)
+                     {
+                         caught = true;
+                     }
+                     client.finished = true;
+                 }(client, caught));
+
+    client.waitFinished();
+    client.push(Stop{});
+    client.join();
+
+    EXPECT_TRUE(caught);
+}
+
+TEST(TaskTest, AskAnotherThread)
+{
+    Server server;
+    Client client;
+    server.start();
+    client.start();
+
+    int total = 0;
+    bool sameThread = true;
+    client.spawn(
+        [](Client& client, Server& server, int& total,
+           bool& sameThread) -> mla::task<>
+        {
+            mla::ObjectPool<Query> pool;
+            for(int i = 0; i < 100; ++i)
+            {
+                auto message = pool.acquire();
+                message->question = i;
+                auto reply = co_await mla::thread::ask(server,
+                                                       std::move(message));
+                total += reply->answer;
+                sameThread = sameThread &&
+                             std::this_thread::get_id() == client.threadId();
+            }
+            client.finished = true;
+        }(client, server, total, sameThread));
+
+    client.waitFinished();
+    server.push(ServerEvent{Stop{}});
+    client.push(Stop{});
+    server.join();
+    client.join();
+
+    EXPECT_EQ(total, 100 * 101 / 2);
+    EXPECT_TRUE(sameThread);
+}
+
+TEST(TaskTest, AskDroppedRequest)
+{
+    Server server;
+    Client client;
+    server.start();
+    client.start();
+
+    bool dropped = false;
+    bool answered = false;
+    mla::ObjectPool<Query> pool;
+    client.spawn(
+        [](Client& client, Server& server, mla::ObjectPool<Query>& pool,
+           bool& dropped, bool& answered) -> mla::task<>
+        {
+            auto message = pool.acquire();
+            message->question = -1;
+            auto reply = co_await mla::thread::ask(server, std::move(message));
+            dropped = !reply;
+
+            message = pool.acquire();
+            message->question = 1;
+            reply = co_await mla::thread::ask(server, std::move(message));
+            answered = reply && reply->answer == 2;
+            client.finished = true;
+        }(client, server, pool, dropped, answered));
+
+    client.waitFinished();
+    server.push(ServerEvent{Stop{}});
+    client.push(Stop{});
+    server.join();
+    client.join();
+
+    EXPECT_TRUE(dropped);
+    EXPECT_TRUE(answered);
+    // The dropped message went back to the pool and was reused
+    EXPECT_EQ(pool.capacity(), 1);
+}
+
+TEST(TaskTest, OffloadJob)
+{
+    Client client;
+    ThreadExecutor executor;
+    client.start();
+
+    int result = 0;
+    bool resumedOnClient = false;
+    client.spawn(
+        [](Client& client, ThreadExecutor& executor, int& result,
+           bool& resumedOnClient) -> mla::task<>
+        {
+            result = co_await mla::thread::offload(
+                executor, [] { return 6 * 7; });
+            resumedOnClient = std::this_thread::get_id() == client.threadId();
+            client.finished = true;
+        }(client, executor, result, resumedOnClient));
+
+    client.waitFinished();
+    client.push(Stop{});
+    client.join();
+
+    EXPECT_EQ(result, 42);
+    EXPECT_TRUE(resumedOnClient);
+}
+
+TEST(TaskTest, SleepFor)
+{
+    auto timer = mla::timer::Timer::instance();
+    timer->start();
+
+    Client client;
+    client.start();
+
+    auto elapsed = std::chrono::steady_clock::duration::zero();
+    client.spawn(
+        [](Client& client,
+           std::chrono::steady_clock::duration& elapsed) -> mla::task<>
+        {
+            auto start = std::chrono::steady_clock::now();
+            co_await mla::timer::sleep_for(20ms);
+            elapsed = std::chrono::steady_clock::now() - start;
+            client.finished = true;
+        }(client, elapsed));
+
+    client.waitFinished();
+    client.push(Stop{});
+    client.join();
+    timer->exit();
+    timer->join();
+
+    EXPECT_GE(elapsed, 20ms);
+}
+
+TEST(TaskTest, SleepForOnGivenTimer)
+{
+    mla::timer::ShardedTimer timer(2);
+    timer.start();
+
+    Client client;
+    client.start();
+
+    auto elapsed = std::chrono::steady_clock::duration::zero();
+    client.spawn(
+        [](Client& client, mla::timer::ShardedTimer& timer,
+           std::chrono::steady_clock::duration& elapsed) -> mla::task<>
+        {
+            auto start = std::chrono::steady_clock::now();
+            co_await mla::timer::sleep_for(timer, 20ms);
+            elapsed = std::chrono::steady_clock::now() - start;
+            client.finished = true;
+        }(client, timer, elapsed));
+
+    client.waitFinished();
+    client.push(Stop{});
+    client.join();
+
+    EXPECT_GE(elapsed, 20ms);
+}
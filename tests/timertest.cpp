@@ -1,8 +1,16 @@
 #include <gtest/gtest.h>
+#include <array>
+#include <map>
 #include <memory>
+#include <random>
+#include <set>
 
 #include "mlafw/timer.h"
 #include "mlafw/eventthread.h"
+#include "mlafw/shardedtimer.h"
+#include "mlafw/timerfd.h"
+
+#include <sys/epoll.h>
 
 namespace mla {
 
@@ -191,4 +199,587 @@ TEST(TimerTests, MultipleTimersSingleThread)
     timer->join();
 }
 
+struct RecordingReceiver : timer::Receiver
+{
+    void timeout(timer::timer_id) override
+    {
+        firedAt = timer::clock_type::now();
+        fired++;
+    }
+
+    timer::clock_type::time_point firedAt;
+    std::atomic<int> fired{0};
+};
+
+TEST(TimerTests, SlackCoalescesNearbyDeadlines)
+{
+    constexpr int NUM_TIMERS = 10;
+
+    timer::Timer timer;
+    timer.start();
+
+    auto start = timer::clock_type::now();
+    std::vector<RecordingReceiver> receivers(NUM_TIMERS);
+    for(int i = 0; i < NUM_TIMERS; ++i)
+        timer.order(&receivers[i], std::chrono::milliseconds(20 + i),
+                    std::chrono::milliseconds(50));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    timer.exit();
+    timer.join();
+
+    // The first deadline allows waiting until 70 ms, by which time all of
+    // them have expired and fire in one batch
+    for(int i = 0; i < NUM_TIMERS; ++i)
+    {
+        EXPECT_EQ(receivers[i].fired, 1);
+        EXPECT_GE(receivers[i].firedAt - start,
+                  std::chrono::milliseconds(20 + i));
+        EXPECT_LT(receivers[i].firedAt - receivers[0].firedAt,
+                  std::chrono::milliseconds(1));
+    }
+}
+
+TEST(TimerTests, BatchFiresAllDueTimers)
+{
+    constexpr int NUM_TIMERS = 1000;
+
+    timer::Timer timer;
+    std::vector<RecordingReceiver> receivers(NUM_TIMERS);
+    for(auto& receiver : receivers)
+        timer.order(&receiver, std::chrono::milliseconds(5));
+
+    timer.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    timer.exit();
+    timer.join();
+
+    for(auto& receiver : receivers)
+        EXPECT_EQ(receiver.fired, 1);
+}
+
+TEST(TimerTests, PeriodicTimers)
+{
+    using namespace std::chrono_literals;
+
+    timer::Timer timer;
+    timer.start();
+
+    RecordingReceiver fixedRate;
+    RecordingReceiver fixedDelay;
+    auto start = timer::clock_type::now();
+    auto rateId = timer.orderPeriodic(&fixedRate, 10ms);
+    auto delayId =
+        timer.orderPeriodic(&fixedDelay, 10ms, timer::Periodic::FixedDelay);
+
+    auto deadline = start + 5s;
+    while((fixedRate.fired < 5 || fixedDelay.fired < 5) &&
+          timer::clock_type::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_TRUE(timer.cancel(rateId));
+    EXPECT_TRUE(timer.cancel(delayId));
+    int rateCount = fixedRate.fired;
+    int delayCount = fixedDelay.fired;
+    auto periods = (timer::clock_type::now() - start) / 10ms;
+
+    std::this_thread::sleep_for(30ms);
+    timer.exit();
+    timer.join();
+
+    // Neither mode fires ahead of its schedule
+    EXPECT_GE(rateCount, 5);
+    EXPECT_LE(rateCount, periods);
+    EXPECT_GE(delayCount, 5);
+    EXPECT_LE(delayCount, periods);
+    EXPECT_EQ(fixedRate.fired, rateCount);
+    EXPECT_EQ(fixedDelay.fired, delayCount);
+    EXPECT_FALSE(timer.cancel(rateId));
+}
+
+TEST(TimerTests, RearmMovesPendingTimer)
+{
+    using namespace std::chrono_literals;
+
+    timer::Timer timer;
+    timer.start();
+
+    RecordingReceiver early;
+    RecordingReceiver late;
+    auto start = timer::clock_type::now();
+    auto earlyId = timer.order(&early, 1s);
+    auto lateId = timer.order(&late, 2s);
+
+    // Both deadlines are far enough out that the re-arms come first
+    EXPECT_TRUE(timer.rearm(earlyId, 20ms));
+    EXPECT_TRUE(timer.rearm(lateId, 60ms));
+
+    auto deadline = start + 5s;
+    while((early.fired == 0 || late.fired == 0) &&
+          timer::clock_type::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+
+    // Finished timers cannot be re-armed, and their ids stay stale even
+    // after their slots have been reused
+    EXPECT_FALSE(timer.rearm(earlyId, 10ms));
+    RecordingReceiver next;
+    auto nextId = timer.order(&next, 1s);
+    EXPECT_NE(nextId, earlyId);
+    EXPECT_FALSE(timer.cancel(earlyId));
+    EXPECT_TRUE(timer.cancel(nextId));
+
+    timer.exit();
+    timer.join();
+
+    EXPECT_EQ(early.fired, 1);
+    EXPECT_EQ(late.fired, 1);
+    EXPECT_GE(early.firedAt - start, 20ms);
+    EXPECT_GE(late.firedAt - start, 60ms);
+    EXPECT_LT(late.firedAt - start, 1s);
+    EXPECT_LE(early.firedAt, late.firedAt);
+    EXPECT_EQ(next.fired, 0);
+}
+
+// Re-arms itself from timeout() until it has fired count times
+struct RearmingReceiver : timer::Receiver
+{
+    explicit RearmingReceiver(timer::Timer& timer) : timer(timer) {}
+
+    void timeout(timer::timer_id id) override
+    {
+        if(++fired < 5)
+            rearmed += timer.rearm(id, std::chrono::milliseconds(1));
+    }
+
+    timer::Timer& timer;
+    std::atomic<int> fired{0};
+    std::atomic<int> rearmed{0};
+};
+
+TEST(TimerTests, RearmFromTimeout)
+{
+    timer::Timer timer;
+    timer.start();
+
+    RearmingReceiver receiver(timer);
+    timer.order(&receiver, std::chrono::milliseconds(1));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    timer.exit();
+    timer.join();
+
+    EXPECT_EQ(receiver.fired, 5);
+    EXPECT_EQ(receiver.rearmed, 4);
+}
+
+// Condition variable backend counting how often the timer thread is woken
+struct CountingBackend : timer::CondVarBackend
+{
+    void notify()
+    {
+        ++notified;
+        timer::CondVarBackend::notify();
+    }
+
+    std::atomic<int> notified{0};
+};
+
+TEST(TimerTests, OrderWakesOnlyForEarlierDeadlines)
+{
+    using namespace std::chrono_literals;
+
+    timer::BasicTimer<CountingBackend> timer;
+    RecordingReceiver receiver;
+
+    auto first = timer.order(&receiver, 1s);
+    EXPECT_EQ(timer.backend().notified, 1);
+    timer.poll();
+
+    // Later deadlines are picked up on the next wakeup
+    auto later = timer.order(&receiver, 2s);
+    EXPECT_TRUE(timer.cancel(first));
+    EXPECT_EQ(timer.backend().notified, 1);
+
+    auto earlier = timer.order(&receiver, 500ms);
+    EXPECT_EQ(timer.backend().notified, 2);
+
+    timer.poll();
+    EXPECT_FALSE(timer.cancel(first));
+    EXPECT_TRUE(timer.cancel(later));
+    EXPECT_TRUE(timer.cancel(earlier));
+    timer.poll();
+    EXPECT_EQ(receiver.fired, 0);
+}
+
+// Backend whose clock runs an hour ahead of the one deadlines are read from
+struct AheadBackend : timer::CondVarBackend
+{
+    static timer::clock_type::time_point now()
+    {
+        return timer::clock_type::now() + std::chrono::hours(1);
+    }
+};
+
+TEST(TimerTests, DueTimersFollowBackendClock)
+{
+    using namespace std::chrono_literals;
+
+    timer::BasicTimer<AheadBackend> timer;
+    RecordingReceiver receiver;
+
+    timer.order(&receiver, 10min);
+    timer.poll();
+    EXPECT_EQ(receiver.fired, 1);
+}
+
+TEST(TimerTests, CancelBeforeTimerThreadDrains)
+{
+    using namespace std::chrono_literals;
+
+    timer::Timer timer;
+    RecordingReceiver cancelled;
+    RecordingReceiver rearmed;
+
+    auto cancelledId = timer.order(&cancelled, 1ms);
+    auto rearmedId = timer.order(&rearmed, 1s);
+    EXPECT_TRUE(timer.cancel(cancelledId));
+    EXPECT_TRUE(timer.rearm(rearmedId, 1ms));
+
+    std::this_thread::sleep_for(5ms);
+    timer.poll();
+
+    EXPECT_EQ(cancelled.fired, 0);
+    EXPECT_EQ(rearmed.fired, 1);
+    EXPECT_FALSE(timer.cancel(cancelledId));
+    EXPECT_FALSE(timer.cancel(rearmedId));
+}
+
+TEST(TimerTests, CancelFromOtherThreads)
+{
+    using namespace std::chrono_literals;
+    constexpr int NUM_THREADS = 4;
+    constexpr int NUM_TIMERS = 1000;
+
+    timer::Timer timer;
+    timer.start();
+
+    // Every thread cancels the timers ordered by the next one
+    std::vector<RecordingReceiver> receivers(NUM_THREADS);
+    std::vector<std::vector<timer::timer_id>> ids(NUM_THREADS);
+    for(int i = 0; i < NUM_THREADS; ++i)
+    {
+        for(int j = 0; j < NUM_TIMERS; ++j)
+            ids[i].push_back(timer.order(&receivers[i], 200ms));
+    }
+
+    std::atomic<int> cancelled{0};
+    std::vector<std::thread> threads;
+    for(int i = 0; i < NUM_THREADS; ++i)
+    {
+        threads.emplace_back(
+            [&, i]
+            {
+                for(auto id : ids[(i + 1) % NUM_THREADS])
+                    cancelled += timer.cancel(id);
+            });
+    }
+    for(auto& thread : threads)
+        thread.join();
+
+    std::this_thread::sleep_for(300ms);
+    timer.exit();
+    timer.join();
+
+    EXPECT_EQ(cancelled, NUM_THREADS * NUM_TIMERS);
+    for(auto& receiver : receivers)
+        EXPECT_EQ(receiver.fired, 0);
+}
+
+TEST(TimerTests, CallableTimers)
+{
+    using namespace std::chrono_literals;
+
+    timer::Timer timer;
+    timer.start();
+
+    std::atomic<int> small{0};
+    std::atomic<int> large{0};
+    std::array<char, 2 * timer::kCallbackInlineSize> padding{};
+    auto owned = std::make_unique<int>(42);
+    auto shared = std::make_shared<int>(0);
+
+    timer.order([&small](timer::timer_id) { ++small; }, 1ms);
+    timer.order([&large, padding](timer::timer_id) { large += padding[0] + 1; },
+                1ms);
+    timer.order([&small, owned = std::move(owned)](timer::timer_id)
+                { small += *owned; },
+                1ms);
+
+    // Cancelled callbacks and their captures are destroyed unfired
+    auto cancelledId =
+        timer.order([shared](timer::timer_id) { ++*shared; }, 1s);
+    EXPECT_EQ(shared.use_count(), 2);
+    EXPECT_TRUE(timer.cancel(cancelledId));
+
+    auto deadline = timer::clock_type::now() + 1s;
+    while((small < 43 || large < 1 || shared.use_count() > 1) &&
+          timer::clock_type::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    timer.exit();
+    timer.join();
+
+    EXPECT_EQ(small, 43);
+    EXPECT_EQ(large, 1);
+    EXPECT_EQ(*shared, 0);
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+struct Tick
+{
+    int source;
+};
+
+using TickEvent = std::variant<std::monostate, Tick>;
+
+class TickThread : public thread::EventThread<TickThread, TickEvent>
+{
+public:
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const Tick& tick)
+    {
+        sum += tick.source;
+        ++ticks;
+    }
+
+    std::atomic<int> sum{0};
+    std::atomic<int> ticks{0};
+};
+
+TEST(TimerTests, TimerPushesEventToEventThread)
+{
+    using namespace std::chrono_literals;
+
+    timer::Timer timer;
+    TickThread thread;
+    timer.start();
+    thread.start();
+
+    timer.order(timer::pushTo(thread, Tick{1}), 1ms);
+    auto periodic = timer.orderPeriodic(timer::pushTo(thread, Tick{10}), 2ms);
+
+    auto deadline = timer::clock_type::now() + 1s;
+    while(thread.ticks < 4 && timer::clock_type::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    EXPECT_TRUE(timer.cancel(periodic));
+    timer.exit();
+    timer.join();
+    thread.exit();
+    thread.join();
+
+    EXPECT_GE(thread.ticks, 4);
+    EXPECT_EQ(thread.sum % 10, 1);
+}
+
+struct OrderedReceiver : timer::Receiver
+{
+    void timeout(timer::timer_id id) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fired.push_back(id);
+    }
+
+    std::mutex mutex;
+    std::vector<timer::timer_id> fired;
+};
+
+TEST(TimerTests, ManyTimersFireInDeadlineOrder)
+{
+    using namespace std::chrono_literals;
+    constexpr int NUM_TIMERS = 2000;
+
+    // Deadline of each timer lies between the clock read before and after
+    // ordering or re-arming it
+    struct Expected
+    {
+        timer::timer_id id;
+        timer::clock_type::time_point earliest;
+        timer::clock_type::time_point latest;
+        bool cancelled = false;
+    };
+
+    timer::Timer timer;
+    OrderedReceiver receiver;
+    std::vector<Expected> expected;
+
+    std::mt19937 random(42);
+    for(int i = 0; i < NUM_TIMERS; ++i)
+    {
+        auto timeout = 20ms + std::chrono::milliseconds(random() % 200);
+        auto before = timer::clock_type::now();
+        auto id = timer.order(&receiver, timeout);
+        expected.push_back({id, before + timeout,
+                            timer::clock_type::now() + timeout});
+    }
+
+    // Cancel every third timer and move every fifth one
+    for(int i = 0; i < NUM_TIMERS; ++i)
+    {
+        if(i % 3 == 0)
+        {
+            EXPECT_TRUE(timer.cancel(expected[i].id));
+            expected[i].cancelled = true;
+        }
+        else if(i % 5 == 0)
+        {
+            auto timeout = 250ms + std::chrono::milliseconds(i % 7);
+            auto before = timer::clock_type::now();
+            EXPECT_TRUE(timer.rearm(expected[i].id, timeout));
+            expected[i].earliest = before + timeout;
+            expected[i].latest = timer::clock_type::now() + timeout;
+        }
+    }
+    std::erase_if(expected, [](const auto& e) { return e.cancelled; });
+
+    timer.start();
+    auto deadline = timer::clock_type::now() + 10s;
+    while(timer::clock_type::now() < deadline)
+    {
+        std::this_thread::sleep_for(10ms);
+        std::lock_guard<std::mutex> lock(receiver.mutex);
+        if(receiver.fired.size() >= expected.size())
+            break;
+    }
+    timer.exit();
+    timer.join();
+
+    ASSERT_EQ(receiver.fired.size(), expected.size());
+
+    std::map<timer::timer_id, Expected> byId;
+    for(const auto& e : expected)
+        byId[e.id] = e;
+    for(std::size_t i = 1; i < receiver.fired.size(); ++i)
+        EXPECT_LE(byId[receiver.fired[i - 1]].earliest,
+                  byId[receiver.fired[i]].latest);
+}
+
+// Records which thread fired the timeouts
+struct ThreadRecordingReceiver : timer::Receiver
+{
+    void timeout(timer::timer_id) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+        fired++;
+    }
+
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> fired{0};
+};
+
+TEST(TimerTests, ShardedTimerOrdersOnCallersShard)
+{
+    using namespace std::chrono_literals;
+    constexpr int NUM_SHARDS = 4;
+    constexpr int TIMERS_PER_THREAD = 100;
+
+    timer::ShardedTimer timer(NUM_SHARDS);
+    timer.start();
+
+    ThreadRecordingReceiver receiver;
+    std::vector<std::vector<timer::timer_id>> ids(NUM_SHARDS);
+    {
+        std::vector<std::jthread> threads;
+        for(int t = 0; t < NUM_SHARDS; ++t)
+            threads.emplace_back(
+                [&, t]
+                {
+                    timer::ShardedTimer::bindCurrentThread(t);
+                    for(int i = 0; i < TIMERS_PER_THREAD; ++i)
+                        ids[t].push_back(timer.order(&receiver, 5ms));
+                });
+    }
+
+    for(int t = 0; t < NUM_SHARDS; ++t)
+    {
+        for(auto id : ids[t])
+            EXPECT_EQ(timer::Timer::shardOf(id), static_cast<std::size_t>(t));
+    }
+
+    // Ids are routed back to their shard from any thread
+    auto cancelled = timer.order(&receiver, 1s);
+    auto moved = timer.order(&receiver, 1s);
+    EXPECT_TRUE(timer.cancel(cancelled));
+    EXPECT_TRUE(timer.rearm(moved, 5ms));
+
+    auto deadline = timer::clock_type::now() + 5s;
+    while(receiver.fired < NUM_SHARDS * TIMERS_PER_THREAD + 1 &&
+          timer::clock_type::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    timer.exit();
+    timer.join();
+
+    EXPECT_EQ(receiver.fired, NUM_SHARDS * TIMERS_PER_THREAD + 1);
+    EXPECT_EQ(receiver.threads.size(), static_cast<std::size_t>(NUM_SHARDS));
+    EXPECT_FALSE(timer.cancel(cancelled));
+}
+
+TEST(TimerTests, TimerFdFiresMicrosecondTimers)
+{
+    using namespace std::chrono_literals;
+
+    timer::FdTimer timer;
+    timer.start();
+
+    std::vector<RecordingReceiver> receivers(3);
+    // Ordered by increasing deadline, so the deadlines keep their order
+    // however long the calls take
+    auto start = timer::clock_type::now();
+    timer.order(&receivers[1], 100us);
+    timer.order(&receivers[0], 300us);
+    timer.order(&receivers[2], 500000ns);
+
+    auto deadline = start + 1s;
+    while(receivers[0].fired + receivers[1].fired + receivers[2].fired < 3 &&
+          timer::clock_type::now() < deadline)
+        std::this_thread::sleep_for(1ms);
+    timer.exit();
+    timer.join();
+
+    EXPECT_GE(receivers[0].firedAt - start, 300us);
+    EXPECT_GE(receivers[1].firedAt - start, 100us);
+    EXPECT_GE(receivers[2].firedAt - start, 500us);
+    EXPECT_LE(receivers[1].firedAt, receivers[0].firedAt);
+    EXPECT_LE(receivers[0].firedAt, receivers[2].firedAt);
+}
+
+TEST(TimerTests, TimerFdDrivenByExternalEpoll)
+{
+    using namespace std::chrono_literals;
+
+    timer::FdTimer timer;
+    int epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    ASSERT_GE(epollFd, 0);
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    ASSERT_EQ(::epoll_ctl(epollFd, EPOLL_CTL_ADD, timer.backend().fd(),
+                          &event),
+              0);
+
+    RecordingReceiver receiver;
+    auto start = timer::clock_type::now();
+    timer.order(&receiver, 2ms);
+
+    // The new order makes the timer readable so the loop can arm it
+    epoll_event ready;
+    while(receiver.fired == 0 &&
+          ::epoll_wait(epollFd, &ready, 1, 1000) == 1)
+        timer.poll();
+    ::close(epollFd);
+
+    EXPECT_EQ(receiver.fired, 1);
+    EXPECT_GE(receiver.firedAt - start, 2ms);
+}
+
 } // namespace mla
@@ -0,0 +1,380 @@
+#include <gtest/gtest.h>
+
+#include "mlafw/eventthread.h"
+#include "mlafw/reactor.h"
+#include "mlafw/task.h"
+#include "mlafw/uring.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+using namespace std::chrono_literals;
+using mla::io::IoDone;
+using mla::io::IoService;
+
+namespace {
+
+std::span<const std::byte> bytes(const std::string& text)
+{
+    return std::as_bytes(std::span(text));
+}
+
+std::string text(std::span<const std::byte> data)
+{
+    return {reinterpret_cast<const char*>(data.data()), data.size()};
+}
+
+struct TempFile
+{
+    TempFile()
+    {
+        fd = ::mkstemp(path);
+    }
+
+    ~TempFile()
+    {
+        ::close(fd);
+        ::unlink(path);
+    }
+
+    char path[32] = "/tmp/uringtestXXXXXX";
+    int fd;
+};
+
+using Event = std::variant<std::monostate, IoDone, mla::thread::Resume>;
+
+// Collects results delivered as events
+class Owner : public mla::thread::EventThread<Owner, Event>
+{
+public:
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const IoDone& done)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[done.tag] = done.result;
+        thread = std::this_thread::get_id();
+    }
+
+    int wait(std::uint64_t tag)
+    {
+        auto end = std::chrono::steady_clock::now() + 2s;
+        while(std::chrono::steady_clock::now() < end)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(auto it = results.find(tag); it != results.end())
+                    return it->second;
+            }
+            std::this_thread::sleep_for(100us);
+        }
+        throw std::runtime_error("No completion");
+    }
+
+    std::mutex mutex;
+    std::map<std::uint64_t, int> results;
+    std::thread::id thread;
+};
+
+class UringTests : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if(!IoService::supported())
+            GTEST_SKIP() << "io_uring is not available";
+        owner.start();
+        service.start();
+    }
+
+    void TearDown() override
+    {
+        service.exit();
+        service.join();
+        owner.exit();
+        owner.join();
+    }
+
+    Owner owner;
+    IoService service;
+};
+
+} // namespace
+
+TEST_F(UringTests, WriteAndReadFile)
+{
+    TempFile file;
+    const std::string data = "persisted without blocking";
+    service.write(file.fd, bytes(data), 0, mla::io::pushTo(owner, 1));
+    EXPECT_EQ(owner.wait(1), static_cast<int>(data.size()));
+
+    std::vector<std::byte> buffer(64);
+    service.read(file.fd, buffer, 0, mla::io::pushTo(owner, 2));
+    auto size = owner.wait(2);
+    ASSERT_EQ(size, static_cast<int>(data.size()));
+    EXPECT_EQ(text(std::span(buffer).first(size)), data);
+    EXPECT_EQ(owner.thread, owner.getId());
+}
+
+TEST_F(UringTests, ErrorsAreResults)
+{
+    std::vector<std::byte> buffer(8);
+    service.read(-1, buffer, 0, mla::io::pushTo(owner, 1));
+    EXPECT_EQ(owner.wait(1), -EBADF);
+}
+
+TEST_F(UringTests, PendingPipeRead)
+{
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+
+    std::vector<std::byte> buffer(16);
+    service.read(fds[0], buffer, IoService::kNoOffset,
+                 mla::io::pushTo(owner, 1));
+    std::this_thread::sleep_for(10ms);
+    {
+        std::lock_guard<std::mutex> lock(owner.mutex);
+        EXPECT_TRUE(owner.results.empty());
+    }
+
+    ASSERT_EQ(::write(fds[1], "ping", 4), 4);
+    EXPECT_EQ(owner.wait(1), 4);
+    EXPECT_EQ(text(std::span(buffer).first(4)), "ping");
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST_F(UringTests, LoopbackSocket)
+{
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    ASSERT_EQ(::bind(listener, reinterpret_cast<sockaddr*>(&address),
+                     sizeof(address)),
+              0);
+    ASSERT_EQ(::listen(listener, 1), 0);
+    ::getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length);
+
+    int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(::connect(client, reinterpret_cast<sockaddr*>(&address),
+                        sizeof(address)),
+              0);
+    int server = ::accept(listener, nullptr, nullptr);
+    ASSERT_GE(server, 0);
+
+    const std::string data = "over loopback";
+    std::vector<std::byte> buffer(64);
+    service.read(server, buffer, IoService::kNoOffset,
+                 mla::io::pushTo(owner, 1));
+    service.write(client, bytes(data), IoService::kNoOffset,
+                  mla::io::pushTo(owner, 2));
+    EXPECT_EQ(owner.wait(2), static_cast<int>(data.size()));
+    EXPECT_EQ(owner.wait(1), static_cast<int>(data.size()));
+    EXPECT_EQ(text(std::span(buffer).first(data.size())), data);
+
+    ::close(server);
+    ::close(client);
+    ::close(listener);
+}
+
+TEST_F(UringTests, RegisteredBuffers)
+{
+    std::vector<std::byte> pinned(4096);
+    iovec buffers[] = {{pinned.data(), pinned.size()}};
+    service.registerBuffers(buffers);
+
+    TempFile file;
+    std::memcpy(pinned.data(), "fixed", 5);
+    service.writeFixed(file.fd, 0, std::span(pinned).first(5), 0,
+                       mla::io::pushTo(owner, 1));
+    EXPECT_EQ(owner.wait(1), 5);
+
+    service.readFixed(file.fd, 0, std::span(pinned).subspan(100, 5), 0,
+                      mla::io::pushTo(owner, 2));
+    EXPECT_EQ(owner.wait(2), 5);
+    EXPECT_EQ(text(std::span(pinned).subspan(100, 5)), "fixed");
+
+    std::vector<std::byte> other(16);
+    EXPECT_THROW(service.writeFixed(file.fd, 0, other, 0, {}),
+                 std::runtime_error);
+    EXPECT_THROW(service.writeFixed(file.fd, 1, pinned, 0, {}),
+                 std::runtime_error);
+}
+
+// More reads pending than the completion queue holds. The service is
+// polled by hand, so completions back up until the reads are all done; the
+// reads over the queue's size wait in the service until earlier ones have
+// completed.
+TEST_F(UringTests, MorePendingReadsThanCompletions)
+{
+    IoService small(2);
+
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+
+    constexpr int NUM_READS = 64;
+    std::vector<std::byte> buffers(NUM_READS);
+    for(int i = 0; i < NUM_READS; ++i)
+        small.read(fds[0], std::span(buffers).subspan(i, 1),
+                   IoService::kNoOffset, mla::io::pushTo(owner, i));
+
+    const std::string data(NUM_READS, 'r');
+    ASSERT_EQ(::write(fds[1], data.data(), data.size()),
+              static_cast<ssize_t>(data.size()));
+    std::this_thread::sleep_for(10ms);
+
+    // Submitting while completions are waiting must not block the poller
+    std::byte extra[1];
+    small.read(fds[0], extra, IoService::kNoOffset,
+               mla::io::pushTo(owner, NUM_READS));
+    ASSERT_EQ(::write(fds[1], "x", 1), 1);
+
+    auto end = std::chrono::steady_clock::now() + 2s;
+    while(std::chrono::steady_clock::now() < end)
+    {
+        small.poll();
+        std::lock_guard<std::mutex> lock(owner.mutex);
+        if(owner.results.size() == NUM_READS + 1)
+            break;
+    }
+    for(int i = 0; i <= NUM_READS; ++i)
+        ASSERT_EQ(owner.wait(i), 1);
+    EXPECT_EQ(text(buffers) + static_cast<char>(extra[0]), data + 'x');
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST_F(UringTests, ExitWithReadsThatNeverComplete)
+{
+    IoService small(2);
+    small.start();
+
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+
+    std::vector<std::byte> buffers(64);
+    for(std::size_t i = 0; i < buffers.size(); ++i)
+        small.read(fds[0], std::span(buffers).subspan(i, 1),
+                   IoService::kNoOffset, {});
+
+    small.exit();
+    small.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+TEST_F(UringTests, BatchedWrites)
+{
+    TempFile file;
+    const std::string block(512, 'b');
+    constexpr int NUM_WRITES = 1000;
+    {
+        IoService::Batch batch(service);
+        for(int i = 0; i < NUM_WRITES; ++i)
+            service.write(file.fd, bytes(block), i * block.size(),
+                          mla::io::pushTo(owner, i));
+    }
+    for(int i = 0; i < NUM_WRITES; ++i)
+        ASSERT_EQ(owner.wait(i), static_cast<int>(block.size()));
+    EXPECT_EQ(::lseek(file.fd, 0, SEEK_END),
+              static_cast<off_t>(NUM_WRITES * block.size()));
+}
+
+TEST_F(UringTests, AwaitFromTask)
+{
+    TempFile file;
+    std::atomic<bool> finished{false};
+    std::string readBack;
+    std::thread::id resumedOn;
+
+    owner.spawn(
+        [](IoService& service, int fd, std::string& readBack,
+           std::thread::id& resumedOn,
+           std::atomic<bool>& finished) -> mla::task<>
+        {
+            const std::string data = "from a task";
+            co_await service.write(fd, bytes(data), 0);
+            std::vector<std::byte> buffer(32);
+            auto size = co_await service.read(fd, buffer, 0);
+            readBack = text(std::span(buffer).first(size));
+            resumedOn = std::this_thread::get_id();
+            finished = true;
+        }(service, file.fd, readBack, resumedOn, finished));
+
+    auto end = std::chrono::steady_clock::now() + 2s;
+    while(!finished && std::chrono::steady_clock::now() < end)
+        std::this_thread::sleep_for(100us);
+    ASSERT_TRUE(finished);
+    EXPECT_EQ(readBack, "from a task");
+    EXPECT_EQ(resumedOn, owner.getId());
+}
+
+namespace {
+
+using ReactorEvent = std::variant<std::monostate, IoDone>;
+
+// Reaps completions itself instead of running the service's thread
+class Reactor : public mla::thread::ReactorThread<Reactor, ReactorEvent>
+{
+public:
+    explicit Reactor(IoService& service) : service(service)
+    {
+        add(service.fd());
+    }
+
+    void onEvent(const std::monostate&) {}
+
+    void onEvent(const IoDone& done)
+    {
+        result = done.result;
+    }
+
+    void onEvent(const mla::thread::IoReady&)
+    {
+        service.poll();
+    }
+
+    IoService& service;
+    std::atomic<int> result{0};
+};
+
+} // namespace
+
+TEST(UringReactorTests, PolledFromReactor)
+{
+    if(!IoService::supported())
+        GTEST_SKIP() << "io_uring is not available";
+
+    IoService service;
+    Reactor reactor(service);
+    reactor.start();
+
+    TempFile file;
+    const std::string data = "reaped by the reactor";
+    service.write(file.fd, bytes(data), 0, mla::io::pushTo(reactor));
+
+    auto end = std::chrono::steady_clock::now() + 2s;
+    while(reactor.result == 0 && std::chrono::steady_clock::now() < end)
+        std::this_thread::sleep_for(100us);
+    EXPECT_EQ(reactor.result, static_cast<int>(data.size()));
+
+    reactor.exit();
+    reactor.join();
+}